@@ -0,0 +1,109 @@
+// Copyright (c) 2017-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <cstring>
+#include "atomicCommit.h"
+#include "logging.h"
+
+DrmAtomicRequest::DrmAtomicRequest(DriDevice &device):mDevice(device)
+{
+	mReq = drmModeAtomicAlloc();
+	if (!mReq)
+	{
+		THROW_FATAL_EXCEPTION("Failed to allocate atomic request");
+	}
+}
+
+DrmAtomicRequest::~DrmAtomicRequest()
+{
+	drmModeAtomicFree(mReq);
+}
+
+bool DrmAtomicRequest::addProperty(uint32_t objectId, DRM_PROP_T prop, uint64_t value)
+{
+	uint32_t propId = mDevice.properties.id(objectId, prop);
+	if (!propId)
+	{
+		LOG_ERROR(MSGID_DRM_SET_PROP_FAILED, 0, "Property %s not found on object %u", DrmPropertyRegistry::name(prop), objectId);
+		mValid = false;
+		return false;
+	}
+	if (drmModeAtomicAddProperty(mReq, objectId, propId, value) < 0)
+	{
+		LOG_ERROR(MSGID_DRM_SET_PROP_FAILED, 0, "Failed to add %s to atomic request: %s", DrmPropertyRegistry::name(prop), strerror(errno));
+		mValid = false;
+		return false;
+	}
+	return true;
+}
+
+bool DrmAtomicRequest::addConnector(uint32_t connectorId, uint32_t crtcId)
+{
+	return addProperty(connectorId, DRM_PROP_CRTC_ID, crtcId);
+}
+
+bool DrmAtomicRequest::addCrtc(uint32_t crtcId, uint32_t modeBlobId, bool active)
+{
+	return addProperty(crtcId, DRM_PROP_MODE_ID, modeBlobId) &&
+	       addProperty(crtcId, DRM_PROP_ACTIVE, active ? 1 : 0);
+}
+
+bool DrmAtomicRequest::addPlane(const DrmPlaneState &state)
+{
+	const uint32_t planeId = state.planeId;
+	//A plane without fb must be detached from its crtc as well.
+	const uint32_t crtcId = state.fbId ? state.crtcId : 0;
+
+	return addProperty(planeId, DRM_PROP_FB_ID, state.fbId) &&
+	       addProperty(planeId, DRM_PROP_CRTC_ID, crtcId) &&
+	       addProperty(planeId, DRM_PROP_CRTC_X, (uint64_t)(int64_t)state.crtc_x) &&
+	       addProperty(planeId, DRM_PROP_CRTC_Y, (uint64_t)(int64_t)state.crtc_y) &&
+	       addProperty(planeId, DRM_PROP_CRTC_W, state.crtc_w) &&
+	       addProperty(planeId, DRM_PROP_CRTC_H, state.crtc_h) &&
+	       addProperty(planeId, DRM_PROP_SRC_X, (uint64_t)state.src_x << 16) &&
+	       addProperty(planeId, DRM_PROP_SRC_Y, (uint64_t)state.src_y << 16) &&
+	       addProperty(planeId, DRM_PROP_SRC_W, (uint64_t)state.src_w << 16) &&
+	       addProperty(planeId, DRM_PROP_SRC_H, (uint64_t)state.src_h << 16) &&
+	       addOptional(planeId, DRM_PROP_ZPOS, state.zpos) &&
+	       addOptional(planeId, DRM_PROP_ALPHA, state.alpha) &&
+	       addOptional(planeId, DRM_PROP_ROTATION, state.rotation);
+}
+
+bool DrmAtomicRequest::addOptional(uint32_t planeId, DRM_PROP_T prop, uint64_t value)
+{
+	//Drivers without zpos stack planes in a fixed order, without alpha or
+	//rotation the plane is always opaque and upright
+	if (!mDevice.properties.has(planeId, prop))
+	{
+		return true;
+	}
+	return addProperty(planeId, prop, value);
+}
+
+int DrmAtomicRequest::commit(uint32_t flags, void *userData)
+{
+	if (!mValid)
+	{
+		return -EINVAL;
+	}
+	if (drmModeAtomicCommit(mDevice.drmModuleFd, mReq, flags, userData))
+	{
+		int err = errno;
+		LOG_ERROR(MSGID_DRM_ATOMIC_COMMIT_FAILED, 0, "Atomic commit (flags 0x%x) failed: %s", flags, strerror(err));
+		return -err;
+	}
+	return 0;
+}
@@ -0,0 +1,49 @@
+// Copyright (c) 2017-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <xf86drm.h>
+#include <xf86drmMode.h>
+#include "driElements.h"
+#include "propertyRegistry.h"
+
+//Collects CRTC, connector and plane properties and applies them with a single
+//drmModeAtomicCommit. Only usable when DriDevice::atomicSupported is set.
+class DrmAtomicRequest
+{
+public:
+	DrmAtomicRequest(DriDevice &device);
+	~DrmAtomicRequest();
+
+	DrmAtomicRequest(const DrmAtomicRequest&) = delete;
+	DrmAtomicRequest& operator=(const DrmAtomicRequest&) = delete;
+
+	bool addProperty(uint32_t objectId, DRM_PROP_T prop, uint64_t value);
+	bool addConnector(uint32_t connectorId, uint32_t crtcId);
+	bool addCrtc(uint32_t crtcId, uint32_t modeBlobId, bool active);
+	bool addPlane(const DrmPlaneState &state);
+
+	int commit(uint32_t flags, void *userData = nullptr);
+
+private:
+	//Properties not every driver has, e.g. zpos, alpha and rotation
+	bool addOptional(uint32_t planeId, DRM_PROP_T prop, uint64_t value);
+
+	DriDevice &mDevice;
+	drmModeAtomicReqPtr mReq = nullptr;
+	bool mValid = true; //false once a property could not be resolved
+};
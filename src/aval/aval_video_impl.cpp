@@ -29,9 +29,13 @@ AVAL_VIDEO_RECT_T aval_video_impl::getDisplayResolution()
 aval_video_impl::aval_video_impl(DeviceCapability &deviceCapability)
 				:mDeviceCapability(deviceCapability)
 				,driElements(mDeviceCapability.getMaxResolution(),
-				             [this](AVAL_VIDEO_SIZE_T min, AVAL_VIDEO_SIZE_T max)
-				             {updatePlanes(min,max);})
+				             [this](const DisplayChange &change)
+				             {onDisplayChange(change);})
 {
+	driElements.setScanoutFbCacheBudget(mDeviceCapability.getScanoutFbCacheBudget());
+	driElements.setBufferPoolBudget(mDeviceCapability.getBufferPoolBudget());
+	driElements.setHotplugDebounce(mDeviceCapability.getHotplugDebounceMs());
+
 	const std::set<std::string>& planeNames = mDeviceCapability.getPlaneNames();
 	int wid = 0;
 
@@ -39,19 +43,43 @@ aval_video_impl::aval_video_impl(DeviceCapability &deviceCapability)
 	{
 		//TODO: window id should come from config file
 		logicalPlanes.push_back(AVAL_PLANE_T{(AVAL_VIDEO_WID_T)wid++, pstr, mDeviceCapability.getMinResolution(), mDeviceCapability.getMaxResolution()});
+		planeOutputs.push_back(mDeviceCapability.getPlaneOutput(pstr));
 	}
 
-	//Acquire a pool of physical plane Ids (one per logical planes)
-	std::vector<unsigned int> pplaneList = driElements.getPlanes();
-
-	auto physicalPlaneId = pplaneList.begin();
-	for(AVAL_PLANE_T &plane : logicalPlanes)
+	//Acquire a physical plane per logical plane from the pool of the output it is
+	//configured for, so windows on different outputs are committed independently
+	std::map<std::string, std::vector<unsigned int>> pplaneLists;
+	static const std::vector<FormatOffer> videoOffers = {
+		{DRM_FORMAT_NV12, DRM_FORMAT_MOD_LINEAR},
+		{DRM_FORMAT_YUV420, DRM_FORMAT_MOD_LINEAR},
+		{DEFAULT_PIXEL_FORMAT, DRM_FORMAT_MOD_LINEAR},
+	};
+	for(size_t i = 0; i < logicalPlanes.size(); ++i)
 	{
-		if(physicalPlaneId != pplaneList.end())
+		const std::string &output = planeOutputs[i];
+		auto pplaneList = pplaneLists.find(output);
+		if (pplaneList == pplaneLists.end())
 		{
-			physicalPlanes.push_back(*physicalPlaneId);
-			videoSinks.insert(std::make_pair(plane.wId, new SinkInfo(*physicalPlaneId)));
-			physicalPlaneId++;
+			pplaneList = pplaneLists.insert(std::make_pair(output, driElements.getPlanes(output))).first;
+		}
+		if(!pplaneList->second.empty())
+		{
+			//Decoders hand out YUV, so windows take the planes that scan it out first
+			FormatChoice choice = driElements.negotiateFormat(videoOffers, pplaneList->second);
+			auto pplane = std::find(pplaneList->second.begin(), pplaneList->second.end(), choice.planeId);
+			if (pplane == pplaneList->second.end())
+			{
+				pplane = pplaneList->second.begin();
+			}
+			unsigned int physicalPlaneId = *pplane;
+			pplaneList->second.erase(pplane);
+			physicalPlanes.push_back(physicalPlaneId);
+			videoSinks.insert(std::make_pair(logicalPlanes[i].wId, new SinkInfo(physicalPlaneId)));
+		}
+		else
+		{
+			LOG_ERROR(MSGID_VIDEO_CONNECT_FAILED, 0, "No free plane for window %d on output '%s'",
+			          logicalPlanes[i].wId, output.c_str());
 		}
 	}
 
@@ -130,18 +158,16 @@ bool aval_video_impl::disconnect(AVAL_VIDEO_WID_T wId, AVAL_VSC_INPUT_SRC_INFO_T
 	return true;
 }
 
-typedef struct{
+typedef struct scale_param_t{
 	/* Signed dest location allows it to be partially off screen */
 	int32_t crtc_x, crtc_y;
 	uint32_t crtc_w, crtc_h;
 
-	/* Source values are 16.16 fixed point */
+	/* Source values are whole pixels, DRIElements converts them to 16.16 */
 	uint32_t src_x, src_y;
 	uint32_t src_h, src_w;
 } scale_param_t;
 
-scale_param_t scale_param;
-
 bool aval_video_impl::applyScaling(AVAL_VIDEO_WID_T wId, AVAL_VIDEO_RECT_T srcInfo, bool adaptive, AVAL_VIDEO_RECT_T inputRegion, AVAL_VIDEO_RECT_T outputRegion)
 {
 	LOG_DEBUG("applyScaling called with srcInfo {x:%u, y:%u, w:%u, h:%u},"
@@ -155,16 +181,38 @@ bool aval_video_impl::applyScaling(AVAL_VIDEO_WID_T wId, AVAL_VIDEO_RECT_T srcIn
 		return false;
 	}
 
-	scale_param = {
+	scale_param_t scale_param {
 			outputRegion.x, outputRegion.y,
 			outputRegion.w, outputRegion.h,
 			inputRegion.x, inputRegion.y,
 			inputRegion.h, inputRegion.w
 	};
 
-	LOG_DEBUG("Calling setPlaneProperties with scale_params %d, %d, %d, %d %d %d %d %d ", scale_param.crtc_x, scale_param.crtc_y, scale_param.crtc_w, scale_param.crtc_h,
+	//Reject layouts the hardware cannot scan out before touching the plane
+	std::vector<DrmPlaneState> layout = driElements.getLayout();
+	for (auto &state : layout)
+	{
+		if (state.planeId == videoSinks[wId]->planeId)
+		{
+			state.crtc_x = scale_param.crtc_x;
+			state.crtc_y = scale_param.crtc_y;
+			state.crtc_w = scale_param.crtc_w;
+			state.crtc_h = scale_param.crtc_h;
+			state.src_x = scale_param.src_x;
+			state.src_y = scale_param.src_y;
+			state.src_w = scale_param.src_w;
+			state.src_h = scale_param.src_h;
+		}
+	}
+	if (!driElements.validateLayout(layout))
+	{
+		LOG_ERROR(MSGID_VIDEO_SCALING_FAILED, 0, "Scaling for plane %d rejected by TEST_ONLY commit", videoSinks[wId]->planeId);
+		return false;
+	}
+
+	LOG_DEBUG("Calling setPlaneGeometry with scale_params %d, %d, %d, %d %d %d %d %d ", scale_param.crtc_x, scale_param.crtc_y, scale_param.crtc_w, scale_param.crtc_h,
 					scale_param.src_x, scale_param.src_y, scale_param.src_w, scale_param.src_h);
-	if (!driElements.setPlaneProperties(SET_SCALING_T, videoSinks[wId]->planeId, (uint64_t)&scale_param))
+	if (!setPlaneGeometry(videoSinks[wId]->planeId, scale_param))
 	{
 		LOG_ERROR(MSGID_VIDEO_SCALING_FAILED, 0, "Failed to apply scaling for plane %d", videoSinks[wId]->planeId);
 		return true;
@@ -174,6 +222,12 @@ bool aval_video_impl::applyScaling(AVAL_VIDEO_WID_T wId, AVAL_VIDEO_RECT_T srcIn
 	return true;
 }
 
+bool aval_video_impl::setPlaneGeometry(unsigned int planeId, const scale_param_t &param)
+{
+	return driElements.setPlaneGeometry(planeId, param.crtc_x, param.crtc_y, param.crtc_w, param.crtc_h,
+	                                    param.src_x, param.src_y, param.src_w, param.src_h);
+}
+
 bool aval_video_impl::setDualVideo(bool enable)
 {//Do nothing.
 	return true;
@@ -190,20 +244,37 @@ bool aval_video_impl::setCompositionParams(std::vector<AVAL_WINDOW_INFO_T> zOrde
 			return false;
 		}
 	}
-	uint64_t zarg = 0;
-	for(size_t i=0, p=physicalPlanes.size()-1; i<zOrder.size() && p>=0; ++i)
+	//Hand out the zpos values the planes already have, lowest to the first window,
+	//so each plane stays within the zpos range its driver accepts.
+	std::vector<uint32_t> zposValues;
+	std::vector<DrmPlaneState> layout = driElements.getLayout();
+	for (auto &window : zOrder)
 	{
-		zarg = zarg <<16;
-		zarg |= zOrder[i].wId;
+		for (auto &state : layout)
+		{
+			if (state.planeId == videoSinks[window.wId]->planeId)
+			{
+				zposValues.push_back(state.zpos);
+			}
+		}
 	}
-
-	uint16_t plane = driElements.getPlaneBase(); //plane must be any valid plane id.
-
-	if (!driElements.setPlaneProperties(SET_Z_ORDER_T, plane,  zarg))
+	//Every window needs a value, else the values would shift onto the wrong windows
+	if (zposValues.size() != zOrder.size())
 	{
-		LOG_ERROR(MSGID_SET_ZORDER_FAILED, 0, "Failed to apply zorder for sink");
+		LOG_ERROR(MSGID_SET_ZORDER_FAILED, 0, "Only %zu of %zu sinks have a plane in the layout",
+		          zposValues.size(), zOrder.size());
 		return false;
 	}
+	std::sort(zposValues.begin(), zposValues.end());
+
+	for(size_t i=0; i<zOrder.size(); ++i)
+	{
+		if (!driElements.setPlaneProperties(SET_Z_ORDER_T, videoSinks[zOrder[i].wId]->planeId, zposValues[i]))
+		{
+			LOG_ERROR(MSGID_SET_ZORDER_FAILED, 0, "Failed to apply zorder for sink %d", zOrder[i].wId);
+			return false;
+		}
+	}
 	return true;
 }
 
@@ -226,10 +297,10 @@ bool aval_video_impl::setWindowBlanking(AVAL_VIDEO_WID_T wId, bool blank, AVAL_V
 				0,0,0,0
 		};
 
-		LOG_DEBUG("Calling setPlaneProperties with scale_params %d, %d, %d, %d %d %d %d %d ", scale_param.crtc_x, scale_param.crtc_y, scale_param.crtc_w, scale_param.crtc_h,
+		LOG_DEBUG("Calling setPlaneGeometry with scale_params %d, %d, %d, %d %d %d %d %d ", scale_param.crtc_x, scale_param.crtc_y, scale_param.crtc_w, scale_param.crtc_h,
 		          scale_param.src_x, scale_param.src_y, scale_param.src_h, scale_param.src_w);
 
-		if (!driElements.setPlaneProperties(SET_SCALING_T, videoSinks[wId]->planeId, (uint64_t) &scale_param))
+		if (!setPlaneGeometry(videoSinks[wId]->planeId, scale_param))
 		{
 			LOG_ERROR(MSGID_VIDEO_BLANKING_FAILED, 0, "Failed to blank wId %d", wId);
 			return false;
@@ -244,10 +315,10 @@ bool aval_video_impl::setWindowBlanking(AVAL_VIDEO_WID_T wId, bool blank, AVAL_V
 				inputRegion.h, inputRegion.w
 		};
 	
-		LOG_DEBUG("Calling setPlaneProperties with scale_params %d, %d, %d, %d %d %d %d %d ", scale_param.crtc_x, scale_param.crtc_y, scale_param.crtc_w, scale_param.crtc_h,
+		LOG_DEBUG("Calling setPlaneGeometry with scale_params %d, %d, %d, %d %d %d %d %d ", scale_param.crtc_x, scale_param.crtc_y, scale_param.crtc_w, scale_param.crtc_h,
 		          scale_param.src_x, scale_param.src_y, scale_param.src_w, scale_param.src_h);
 
-		if (!driElements.setPlaneProperties(SET_SCALING_T, videoSinks[wId]->planeId, (uint64_t) &scale_param))
+		if (!setPlaneGeometry(videoSinks[wId]->planeId, scale_param))
 		{
 			LOG_ERROR(MSGID_VIDEO_UNBLANKING_FAILED, 0, "Failed to apply scaling for plane %d", videoSinks[wId]->planeId);
 			return false;
@@ -264,7 +335,23 @@ bool aval_video_impl::setDisplayResolution(AVAL_VIDEO_SIZE_T win)
 		LOG_ERROR(MSGID_MODE_CHANGE_FAILED,0,"Invalid resolution specified %dx%d ",win.w,win.h);
 		return false;
 	}
-	if (driElements.changeMode(win.w, win.h))
+	//Only sizes the sink offers can be set, tell the caller now rather than from the completion
+	std::vector<AVAL_VIDEO_SIZE_T> modes = driElements.getSupportedModes();
+	if (std::none_of(modes.begin(), modes.end(), [&win](const AVAL_VIDEO_SIZE_T &mode)
+	                 { return mode.w == win.w && mode.h == win.h; }))
+	{
+		LOG_ERROR(MSGID_MODE_CHANGE_FAILED,0,"Resolution %dx%d not supported by the display",win.w,win.h);
+		return false;
+	}
+	//The modeset runs on the DRM modeset worker, window updates are served meanwhile
+	AVAL_VIDEO_SIZE_T size = win;
+	if (!driElements.changeModeAsync(win.w, win.h, 0, [size](bool ok)
+	{
+		if (!ok)
+		{
+			LOG_ERROR(MSGID_MODE_CHANGE_FAILED,0,"Resolution change failed %dx%d ",size.w,size.h);
+		}
+	}))
 	{
 		LOG_ERROR(MSGID_MODE_CHANGE_FAILED,0,"Resolution change failed %dx%d ",win.w,win.h);
 		return false;
@@ -272,10 +359,26 @@ bool aval_video_impl::setDisplayResolution(AVAL_VIDEO_SIZE_T win)
 	return true;
 }
 
-void aval_video_impl::updatePlanes(AVAL_VIDEO_SIZE_T min, AVAL_VIDEO_SIZE_T max) //callback function
+void aval_video_impl::onDisplayChange(const DisplayChange &change) //callback function
 {
-	for (auto p : this->logicalPlanes)
+	//Only the size range of an output matters to the planes shown on it
+	if (change.type != DISPLAY_MODES_CHANGED || change.maxSize.w == 0 || change.maxSize.h == 0)
 	{
+		LOG_DEBUG("%s: %s", change.output.c_str(), displayChangeName(change.type));
+		return;
+	}
+	updatePlanes(change.output, change.primary, change.minSize, change.maxSize);
+}
+
+void aval_video_impl::updatePlanes(const std::string &output, bool primary, AVAL_VIDEO_SIZE_T min, AVAL_VIDEO_SIZE_T max)
+{
+	for (size_t i = 0; i < logicalPlanes.size(); ++i)
+	{
+		if (planeOutputs[i] != output && !(planeOutputs[i].empty() && primary))
+		{
+			continue;
+		}
+		AVAL_PLANE_T &p = logicalPlanes[i];
 		if(mDeviceCapability.getMaxResolution().h >= max.h
 		   || mDeviceCapability.getMaxResolution().w >= max.w)
 		{
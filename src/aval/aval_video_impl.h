@@ -34,10 +34,13 @@ public:
 	}
 };
 
+struct scale_param_t;
+
 class aval_video_impl : public AVAL_Video
 {
 private:
 	std::vector<AVAL_PLANE_T> logicalPlanes;
+	std::vector<std::string> planeOutputs; //output of each logical plane, empty for the primary one
 	std::vector<unsigned int> physicalPlanes;
 	std::unordered_map<AVAL_VIDEO_WID_T, SinkInfo*> videoSinks;
 	DeviceCapability &mDeviceCapability;
@@ -45,8 +48,10 @@ private:
 
 	bool isValidSink(AVAL_VIDEO_WID_T wId);
 	bool isSinkConnected(AVAL_VIDEO_WID_T wId);
-	void updatePlanes(AVAL_VIDEO_SIZE_T, AVAL_VIDEO_SIZE_T);
+	void onDisplayChange(const DisplayChange &change);
+	void updatePlanes(const std::string &output, bool primary, AVAL_VIDEO_SIZE_T min, AVAL_VIDEO_SIZE_T max);
 	bool isValidMode(AVAL_VIDEO_SIZE_T win);
+	bool setPlaneGeometry(unsigned int planeId, const scale_param_t &param);
 public:
 
 	aval_video_impl(DeviceCapability &capability);
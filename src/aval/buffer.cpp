@@ -52,6 +52,8 @@
 #include <string.h>
 #include <sys/ioctl.h>
 #include <iostream>
+#include <mutex>
+#include <set>
 
 #include "drm.h"
 #include "drm_fourcc.h"
@@ -59,6 +61,9 @@
 #include "libdrm_macros.h"
 #include "xf86drm.h"
 #include "buffers.h"
+#include "bufferPool.h"
+#include "mappingCache.h"
+#include "pixelFormat.h"
 #include "logging.h"
 
 
@@ -66,7 +71,18 @@
  * Buffers management
  */
 
-static struct bo *
+//GEM handles of live dumb buffers, a dma-buf exported by one of them imports
+//back to the same handle
+static std::mutex live_mutex;
+static std::set<std::pair<int, unsigned>> live_handles;
+
+bool bo_owns_handle(int fd, unsigned handle)
+{
+	std::lock_guard<std::mutex> lock(live_mutex);
+	return live_handles.count(std::make_pair(fd, handle));
+}
+
+struct bo *
 bo_create_dumb(int fd, unsigned int width, unsigned int height, unsigned int bpp)
 {
 	struct drm_mode_create_dumb arg;
@@ -96,20 +112,52 @@ bo_create_dumb(int fd, unsigned int width, unsigned int height, unsigned int bpp
 	bo->handle = arg.handle;
 	bo->size = arg.size;
 	bo->pitch = arg.pitch;
+	bo->bpp = bpp;
+	bo->width = width;
+	bo->height = height;
+
+	std::lock_guard<std::mutex> lock(live_mutex);
+	live_handles.insert(std::make_pair(fd, bo->handle));
 
 	return bo;
 }
 
 int bo_map(struct bo *bo, void **out)
 {
-	struct drm_mode_map_dumb arg;
-	void *map;
-	int ret;
 	if (!bo)
 	{
 		fprintf(stderr, " \n *** bo is null \n");
 		return -1;
 	}
+	return BoMappingCache::instance().map(bo, out);
+}
+
+void bo_unmap(struct bo *bo)
+{
+	if (!bo)
+		return;
+	BoMappingCache::instance().unmap(bo);
+}
+
+int bo_export(struct bo *bo, int *prime_fd)
+{
+	if (!bo)
+		return -EINVAL;
+	if (drmPrimeHandleToFD(bo->fd, bo->handle, DRM_CLOEXEC | DRM_RDWR, prime_fd))
+	{
+		int err = errno;
+		LOG_ERROR(MSGID_BUFFER_CREATION_FAILED, 0, "failed to export dumb buffer %u: %s", bo->handle, strerror(err));
+		return -err;
+	}
+	bo->exported = true;
+	return 0;
+}
+
+int bo_map_dumb(struct bo *bo)
+{
+	struct drm_mode_map_dumb arg;
+	void *map;
+	int ret;
 	memset(&arg, 0, sizeof(arg));
 	arg.handle = bo->handle;
 
@@ -129,12 +177,11 @@ int bo_map(struct bo *bo, void **out)
 	}
 
 	bo->ptr = map;
-	*out = map;
 
 	return 0;
 }
 
-void bo_unmap(struct bo *bo)
+void bo_unmap_dumb(struct bo *bo)
 {
 	if (!bo->ptr)
 		return;
@@ -149,185 +196,43 @@ bo_create(int fd, unsigned int format,
           unsigned int handles[4], unsigned int pitches[4],
           unsigned int offsets[4]) // enum util_fill_pattern pattern
 {
-	unsigned int virtual_height;
-	struct bo *bo;
-	unsigned int bpp;
-
-
-	switch (format) {
-		case DRM_FORMAT_NV12:
-		case DRM_FORMAT_NV21:
-		case DRM_FORMAT_NV16:
-		case DRM_FORMAT_NV61:
-		case DRM_FORMAT_YUV420:
-		case DRM_FORMAT_YVU420:
-			bpp = 8;
-			break;
-
-		case DRM_FORMAT_ARGB4444:
-		case DRM_FORMAT_XRGB4444:
-		case DRM_FORMAT_ABGR4444:
-		case DRM_FORMAT_XBGR4444:
-		case DRM_FORMAT_RGBA4444:
-		case DRM_FORMAT_RGBX4444:
-		case DRM_FORMAT_BGRA4444:
-		case DRM_FORMAT_BGRX4444:
-		case DRM_FORMAT_ARGB1555:
-		case DRM_FORMAT_XRGB1555:
-		case DRM_FORMAT_ABGR1555:
-		case DRM_FORMAT_XBGR1555:
-		case DRM_FORMAT_RGBA5551:
-		case DRM_FORMAT_RGBX5551:
-		case DRM_FORMAT_BGRA5551:
-		case DRM_FORMAT_BGRX5551:
-		case DRM_FORMAT_RGB565:
-		case DRM_FORMAT_BGR565:
-		case DRM_FORMAT_UYVY:
-		case DRM_FORMAT_VYUY:
-		case DRM_FORMAT_YUYV:
-		case DRM_FORMAT_YVYU:
-			bpp = 16;
-			break;
-
-		case DRM_FORMAT_BGR888:
-		case DRM_FORMAT_RGB888:
-			bpp = 24;
-			break;
-
-		case DRM_FORMAT_ARGB8888:
-		case DRM_FORMAT_XRGB8888:
-		case DRM_FORMAT_ABGR8888:
-		case DRM_FORMAT_XBGR8888:
-		case DRM_FORMAT_RGBA8888:
-		case DRM_FORMAT_RGBX8888:
-		case DRM_FORMAT_BGRA8888:
-		case DRM_FORMAT_BGRX8888:
-		case DRM_FORMAT_ARGB2101010:
-		case DRM_FORMAT_XRGB2101010:
-		case DRM_FORMAT_ABGR2101010:
-		case DRM_FORMAT_XBGR2101010:
-		case DRM_FORMAT_RGBA1010102:
-		case DRM_FORMAT_RGBX1010102:
-		case DRM_FORMAT_BGRA1010102:
-		case DRM_FORMAT_BGRX1010102:
-			bpp = 32;
-			break;
-
-		default:
-			fprintf(stderr, "unsupported format 0x%08x\n",  format);
-			return NULL;
-	}
-
-	switch (format) {
-		case DRM_FORMAT_NV12:
-		case DRM_FORMAT_NV21:
-		case DRM_FORMAT_YUV420:
-		case DRM_FORMAT_YVU420:
-			virtual_height = height * 3 / 2;
-			break;
-
-		case DRM_FORMAT_NV16:
-		case DRM_FORMAT_NV61:
-			virtual_height = height * 2;
-			break;
-
-		default:
-			virtual_height = height;
-			break;
+	const struct util_format_info *info = util_format_info_find(format);
+	if (!info) {
+		fprintf(stderr, "unsupported format 0x%08x\n",  format);
+		return NULL;
 	}
 
-	bo = bo_create_dumb(fd, width, virtual_height, bpp);
+	unsigned int virtual_height = util_format_virtual_height(*info, height);
+	struct bo *bo = DumbBufferPool::instance().acquire(fd, width, virtual_height, info->bpp);
+	if (!bo)
+		bo = bo_create_dumb(fd, width, virtual_height, info->bpp);
 	if (!bo)
 		return NULL;
 
 	//Get handles and pitches required by AddFb
-	switch (format) {
-		case DRM_FORMAT_UYVY:
-		case DRM_FORMAT_VYUY:
-		case DRM_FORMAT_YUYV:
-		case DRM_FORMAT_YVYU:
-			offsets[0] = 0;
-			handles[0] = bo->handle;
-			pitches[0] = bo->pitch;
-			break;
-
-		case DRM_FORMAT_NV12:
-		case DRM_FORMAT_NV21:
-		case DRM_FORMAT_NV16:
-		case DRM_FORMAT_NV61:
-			offsets[0] = 0;
-			handles[0] = bo->handle;
-			pitches[0] = bo->pitch;
-			pitches[1] = pitches[0];
-			offsets[1] = pitches[0] * height;
-			handles[1] = bo->handle;
-
-			break;
-
-		case DRM_FORMAT_YUV420:
-		case DRM_FORMAT_YVU420:
-			offsets[0] = 0;
-			handles[0] = bo->handle;
-			pitches[0] = bo->pitch;
-			pitches[1] = pitches[0] / 2;
-			offsets[1] = pitches[0] * height;
-			handles[1] = bo->handle;
-			pitches[2] = pitches[1];
-			offsets[2] = offsets[1] + pitches[1] * height / 2;
-			handles[2] = bo->handle;
-			break;
-
-		case DRM_FORMAT_ARGB4444:
-		case DRM_FORMAT_XRGB4444:
-		case DRM_FORMAT_ABGR4444:
-		case DRM_FORMAT_XBGR4444:
-		case DRM_FORMAT_RGBA4444:
-		case DRM_FORMAT_RGBX4444:
-		case DRM_FORMAT_BGRA4444:
-		case DRM_FORMAT_BGRX4444:
-		case DRM_FORMAT_ARGB1555:
-		case DRM_FORMAT_XRGB1555:
-		case DRM_FORMAT_ABGR1555:
-		case DRM_FORMAT_XBGR1555:
-		case DRM_FORMAT_RGBA5551:
-		case DRM_FORMAT_RGBX5551:
-		case DRM_FORMAT_BGRA5551:
-		case DRM_FORMAT_BGRX5551:
-		case DRM_FORMAT_RGB565:
-		case DRM_FORMAT_BGR565:
-		case DRM_FORMAT_BGR888:
-		case DRM_FORMAT_RGB888:
-		case DRM_FORMAT_ARGB8888:
-		case DRM_FORMAT_XRGB8888:
-		case DRM_FORMAT_ABGR8888:
-		case DRM_FORMAT_XBGR8888:
-		case DRM_FORMAT_RGBA8888:
-		case DRM_FORMAT_RGBX8888:
-		case DRM_FORMAT_BGRA8888:
-		case DRM_FORMAT_BGRX8888:
-		case DRM_FORMAT_ARGB2101010:
-		case DRM_FORMAT_XRGB2101010:
-		case DRM_FORMAT_ABGR2101010:
-		case DRM_FORMAT_XBGR2101010:
-		case DRM_FORMAT_RGBA1010102:
-		case DRM_FORMAT_RGBX1010102:
-		case DRM_FORMAT_BGRA1010102:
-		case DRM_FORMAT_BGRX1010102:
-			offsets[0] = 0;
-			handles[0] = bo->handle;
-			pitches[0] = bo->pitch;
-		break;
-	}
-
+	util_format_layout(info, height, bo->pitch, bo->handle, handles, pitches, offsets);
 
 	return bo;
 }
 
 void bo_destroy(struct bo *bo)
+{
+	if(!bo) return;
+	//An exported buffer may still be in use through its dma-buf, it must not
+	//be handed to the next bo_create
+	if (bo->exported || !DumbBufferPool::instance().recycle(bo))
+		bo_destroy_dumb(bo);
+}
+
+void bo_destroy_dumb(struct bo *bo)
 {
 	struct drm_mode_destroy_dumb arg;
 	int ret;
-	if(!bo) return;
+	BoMappingCache::instance().forget(bo);
+	{
+		std::lock_guard<std::mutex> lock(live_mutex);
+		live_handles.erase(std::make_pair(bo->fd, bo->handle));
+	}
 	memset(&arg, 0, sizeof(arg));
 	arg.handle = bo->handle;
 
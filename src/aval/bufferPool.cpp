@@ -0,0 +1,170 @@
+// Copyright (c) 2017-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include "bufferPool.h"
+#include "buffers.h"
+#include "logging.h"
+
+DumbBufferPool& DumbBufferPool::instance()
+{
+	static DumbBufferPool pool;
+	return pool;
+}
+
+struct bo* DumbBufferPool::acquire(int fd, unsigned int width, unsigned int height, unsigned int bpp)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mStats.allocations++;
+	auto freeList = mFreeLists.find(Key(fd, bpp, width, height));
+	if (freeList == mFreeLists.end())
+	{
+		return nullptr;
+	}
+	//Most recently freed first, its pages are the likeliest to be hot
+	IdleRef idle = freeList->second.back();
+	freeList->second.pop_back();
+	if (freeList->second.empty())
+	{
+		mFreeLists.erase(freeList);
+	}
+	struct bo *bo = idle->bo;
+	mIdle.erase(idle);
+	mStats.hits++;
+	mStats.retainedBytes -= bo->size;
+	mStats.retainedBuffers--;
+	return bo;
+}
+
+bool DumbBufferPool::recycle(struct bo *bo)
+{
+	std::vector<struct bo*> victims;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		if (bo->size > mBudget)
+		{
+			mStats.destroyed++;
+			return false;
+		}
+		Key key(bo->fd, bo->bpp, bo->width, bo->height);
+		mIdle.push_front(Idle{key, bo});
+		mFreeLists[key].push_back(mIdle.begin());
+		mStats.recycled++;
+		mStats.retainedBytes += bo->size;
+		mStats.retainedBuffers++;
+		while (mStats.retainedBytes > mBudget)
+		{
+			evict(std::prev(mIdle.end()), victims);
+		}
+	}
+	destroy(victims);
+	return true;
+}
+
+void DumbBufferPool::setBudget(size_t bytes)
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mBudget = bytes;
+	}
+	trim(bytes);
+}
+
+size_t DumbBufferPool::budget()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mBudget;
+}
+
+void DumbBufferPool::trim(size_t bytes)
+{
+	std::vector<struct bo*> victims;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		while (mStats.retainedBytes > bytes)
+		{
+			evict(std::prev(mIdle.end()), victims);
+		}
+	}
+	if (!victims.empty())
+	{
+		LOG_DEBUG("Trimmed %zu idle dumb buffers", victims.size());
+	}
+	destroy(victims);
+}
+
+void DumbBufferPool::clear(int fd)
+{
+	std::vector<struct bo*> victims;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		for (auto idle = mIdle.begin(); idle != mIdle.end();)
+		{
+			IdleRef next = std::next(idle);
+			if (std::get<0>(idle->key) == fd)
+			{
+				evict(idle, victims);
+			}
+			idle = next;
+		}
+	}
+	destroy(victims);
+}
+
+void DumbBufferPool::evict(IdleRef idle, std::vector<struct bo*> &victims)
+{
+	auto freeList = mFreeLists.find(idle->key);
+	std::vector<IdleRef> &refs = freeList->second;
+	refs.erase(std::find(refs.begin(), refs.end(), idle));
+	if (refs.empty())
+	{
+		mFreeLists.erase(freeList);
+	}
+	mStats.retainedBytes -= idle->bo->size;
+	mStats.retainedBuffers--;
+	mStats.trimmed++;
+	mStats.destroyed++;
+	victims.push_back(idle->bo);
+	mIdle.erase(idle);
+}
+
+void DumbBufferPool::destroy(const std::vector<struct bo*> &victims)
+{
+	for (auto bo : victims)
+	{
+		bo_destroy_dumb(bo);
+	}
+}
+
+DumbBufferPoolStats DumbBufferPool::stats()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mStats;
+}
+
+std::string DumbBufferPool::summary()
+{
+	DumbBufferPoolStats s = stats();
+	char line[192];
+	snprintf(line, sizeof(line), "dumb buffers: %" PRIu64 " allocations, %.1f%% recycled, %zu idle (%zu KiB), %"
+	         PRIu64 " destroyed (%" PRIu64 " trimmed)", s.allocations,
+	         s.allocations ? 100.0 * s.hits / s.allocations : 0.0, s.retainedBuffers, s.retainedBytes >> 10,
+	         s.destroyed, s.trimmed);
+	return line;
+}
@@ -0,0 +1,90 @@
+// Copyright (c) 2017-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+struct bo;
+
+struct DumbBufferPoolStats
+{
+	uint64_t allocations = 0; //bo_create calls
+	uint64_t hits = 0;        //of those served from a free list
+	uint64_t recycled = 0;    //bo_destroy calls that kept the buffer
+	uint64_t destroyed = 0;   //buffers returned to the kernel
+	uint64_t trimmed = 0;     //of those dropped for the budget or memory pressure
+	size_t retainedBytes = 0;
+	size_t retainedBuffers = 0;
+};
+
+//Dumb buffers freed by bo_destroy, kept for the next bo_create of the same
+//device, bpp, width and virtual height. This spares the create and destroy
+//ioctls and the page faults of fresh kernel memory. A recycled buffer keeps
+//its old content and mapping. The least recently freed buffers go first once
+//the retained size exceeds the budget or memory gets short.
+class DumbBufferPool
+{
+public:
+	static constexpr size_t DEFAULT_BUDGET = 16 << 20; //two 1080p XRGB frames
+
+	static DumbBufferPool& instance();
+
+	DumbBufferPool(const DumbBufferPool&) = delete;
+	DumbBufferPool& operator=(const DumbBufferPool&) = delete;
+
+	//An idle buffer of this layout, nullptr if there is none
+	struct bo* acquire(int fd, unsigned int width, unsigned int height, unsigned int bpp);
+	//Keep a buffer for reuse, false if the caller has to destroy it
+	bool recycle(struct bo *bo);
+	void setBudget(size_t bytes);
+	size_t budget();
+	//Destroy idle buffers until at most bytes are retained
+	void trim(size_t bytes);
+	//Destroy the idle buffers of a device, before its fd is closed
+	void clear(int fd);
+
+	DumbBufferPoolStats stats();
+	std::string summary();
+
+private:
+	DumbBufferPool() {}
+
+	typedef std::tuple<int, unsigned int, unsigned int, unsigned int> Key; //fd, bpp, width, virtual height
+	struct Idle
+	{
+		Key key;
+		struct bo *bo;
+	};
+	typedef std::list<Idle>::iterator IdleRef;
+
+	void evict(IdleRef idle, std::vector<struct bo*> &victims);
+	void destroy(const std::vector<struct bo*> &victims);
+
+	std::mutex mMutex;
+	std::list<Idle> mIdle; //most recently freed first
+	std::map<Key, std::vector<IdleRef>> mFreeLists; //oldest first within a list
+	size_t mBudget = DEFAULT_BUDGET;
+	DumbBufferPoolStats mStats;
+};
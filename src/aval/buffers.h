@@ -48,6 +48,11 @@ struct bo
 	size_t offset;
 	size_t pitch;
 	unsigned handle;
+	unsigned bpp;    //as allocated, the buffer pool key
+	unsigned width;
+	unsigned height; //virtual height, including chroma planes
+	unsigned map_refs; //bo_map calls not yet matched by bo_unmap
+	bool exported;     //shared as a dma-buf, never recycled by the buffer pool
 	//TODO:: Store format here?
 };
 
@@ -55,7 +60,25 @@ struct bo *bo_create(int fd, unsigned int format,
                      unsigned int width, unsigned int height,
                      unsigned int handles[4], unsigned int pitches[4],
                      unsigned int offsets[4]);
+//Hands the buffer to the DumbBufferPool, which may keep it for the next bo_create
 void bo_destroy(struct bo *bo);
 
+//Kernel allocation and release, bypassing the buffer pool
+struct bo *bo_create_dumb(int fd, unsigned int width, unsigned int height, unsigned int bpp);
+void bo_destroy_dumb(struct bo *bo);
+
+//The mapping is cached per bo by BoMappingCache and shared by all callers.
+//Each bo_map must be matched by a bo_unmap, which keeps the mapping for
+//the next caller. It is only torn down on destroy or eviction.
 int bo_map(struct bo *bo, void **out);
 void bo_unmap(struct bo *bo);
+
+//Export as a dma-buf fd for decoders, GPUs or other devices, the caller closes it.
+//The memory may outlive the bo through that fd, so bo_destroy frees it for real.
+int bo_export(struct bo *bo, int *prime_fd);
+//True if the GEM handle belongs to a live bo of this device
+bool bo_owns_handle(int fd, unsigned handle);
+
+//Raw map and unmap of bo->ptr, bypassing the mapping cache
+int bo_map_dumb(struct bo *bo);
+void bo_unmap_dumb(struct bo *bo);
@@ -14,6 +14,9 @@
 //
 // SPDX-License-Identifier: Apache-2.0
 
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
 #include "driElements.h"
 #include "logging.h"
 
@@ -25,122 +28,283 @@ DrmConnector::DrmConnector(int drmModulefd, drmModeConnectorPtr pConnector)
 	{
 		THROW_FATAL_EXCEPTION("Invalid connector ");
 	}
-	mConnectorPtr = pConnector;
+	mConnectorPtr.reset(pConnector);
 	mDrmModulefd = drmModulefd;
 	mName = util_lookup_connector_type_name(pConnector->connector_type);
+	mOutputName = mName + "-" + std::to_string(pConnector->connector_type_id);
+	mModes.assign(pConnector->modes, pConnector->modes + pConnector->count_modes);
+	buildModeTable();
 }
 
 
+std::atomic<uint64_t> DrmConnector::sFullProbes(0);
+std::atomic<uint64_t> DrmConnector::sCurrentReads(0);
+
 bool DrmConnector::isPlugged()
 {
-	//Reset connectorPtr
-	uint32_t conn_id = 0;
+	return refresh(true);
+}
+
+bool DrmConnector::refresh(bool probe)
+{
 	if (!mConnectorPtr)
 	{
 		THROW_FATAL_EXCEPTION("Initialization error -found null connector");
 	}
+	uint32_t conn_id = mConnectorPtr->connector_id;
+	//A full probe runs detect and may read the EDID over DDC, the current
+	//read only returns what the kernel already knows
+	drmModeConnectorPtr fresh = probe ? drmModeGetConnector(mDrmModulefd, conn_id)
+	                                  : drmModeGetConnectorCurrent(mDrmModulefd, conn_id);
+	if (probe)
+	{
+		sFullProbes++;
+	}
 	else
 	{
-		conn_id = mConnectorPtr->connector_id;
-		drmModeFreeConnector(mConnectorPtr);
+		sCurrentReads++;
 	}
-	mConnectorPtr = drmModeGetConnector(mDrmModulefd,conn_id);
-	return (mConnectorPtr->connection == DRM_MODE_CONNECTED && mConnectorPtr->count_modes !=0);
+	if (!fresh)
+	{
+		LOG_ERROR(MSGID_DEVICE_ERROR, 0, "Failed to read connector %u: %s", conn_id, strerror(errno));
+		return isConnected();
+	}
+	adopt(fresh);
+	return isConnected();
 }
 
-bool DrmConnector::getModeRange(DrmDisplayMode &min, DrmDisplayMode &max)
+void DrmConnector::adopt(drmModeConnectorPtr fresh)
 {
-	if (!isPlugged())
-		return false;
-	//TODO::expecting sorted modes. confirm that it will be always sorted or fixit
-	max.mModeInfoPtr = &mConnectorPtr->modes[mConnectorPtr->count_modes-1];
-	min.mModeInfoPtr = &mConnectorPtr->modes[0];
-	return true;
+	mConnectorPtr.reset(fresh); //the old snapshot is released here
+	mModes.assign(fresh->modes, fresh->modes + fresh->count_modes);
+	mModesFromCache = false;
+	buildModeTable();
+}
+
+void DrmConnector::useCachedModes(const EdidModeTable &table)
+{
+	mModes = table.modes;
+	mModesFromCache = true;
+	buildModeTable(); //the preferred mode is flagged in the cached modes themselves
 }
 
-DrmDisplayMode DrmConnector::getMode(const std::string mode_name, const uint32_t vRefresh)
+DisplayState DrmConnector::displayState() const
 {
-	for (int i = 0; i < mConnectorPtr->count_modes; i++)
+	DisplayState state;
+	state.connected = isConnected();
+	state.sizes = mSupportedSizes;
+	if (mPreferredMode >= 0)
 	{
-		drmModeModeInfo* mode = &mConnectorPtr->modes[i];
-		if (mode_name == mode->name)
-		{
-			/* If the vertical refresh frequency is not specified then return the
-			 * first mode that match with the name. Else, return the mode that match
-			 * the name and the specified vertical refresh frequency.
-			 */
-			if (vRefresh == 0 || mode->vrefresh == vRefresh)
-				return DrmDisplayMode(mode);
-		}
+		state.preferred = mModes[mPreferredMode];
 	}
-	return DrmDisplayMode();
+	state.edidHash = mEdidHash;
+	return state;
 }
 
-bool DrmConnector::isModeSupported(std::string mode_name, const uint32_t vRefresh)
+void DrmConnector::updateEdidHash()
 {
-	for (int i = 0; i < mConnectorPtr->count_modes; i++) {
-		drmModeModeInfo *mode = &mConnectorPtr->modes[i];
-		if (mode_name == mode->name) {
-			/* If the vertical refresh frequency is not specified then return the
-			 * first mode that match with the name. Else, return the mode that match
-			 * the name and the specified vertical refresh frequency.
-			 */
-			if (vRefresh == 0 || mode->vrefresh == vRefresh)
-				return true;
-		}
-	}
-	return false;
+	Edid edid = getEdid();
+	mEdidHash = edid.size() ? EdidCache::hash(edid.data(), edid.size()) : 0;
 }
 
+EdidModeTable DrmConnector::getModeTable() const
+{
+	EdidModeTable table;
+	table.modes = mModes;
+	table.preferred = mPreferredMode;
+	return table;
+}
 
+bool DrmConnector::isConnected() const
+{
+	return mConnectorPtr && mConnectorPtr->connection == DRM_MODE_CONNECTED && !mModes.empty();
+}
 
-Edid DrmConnector::getEdid()
+//FNV-1a over the fields that matter to AVAL clients
+static void hashValue(uint64_t &hash, uint64_t value)
 {
-	int j;
-	drmModePropertyPtr props;
+	for (int i = 0; i < 8; i++)
+	{
+		hash ^= (value >> (i * 8)) & 0xff;
+		hash *= 1099511628211ULL;
+	}
+}
+
+//Largest first, then highest refresh. Equal modes keep the preferred one,
+//or failing that the kernel's order.
+static bool modeBefore(const drmModeModeInfo &a, const drmModeModeInfo &b)
+{
+	uint32_t areaA = uint32_t(a.hdisplay) * a.vdisplay;
+	uint32_t areaB = uint32_t(b.hdisplay) * b.vdisplay;
+	if (areaA != areaB)
+		return areaA > areaB;
+	if (a.hdisplay != b.hdisplay)
+		return a.hdisplay > b.hdisplay;
+	bool interlaceA = a.flags & DRM_MODE_FLAG_INTERLACE;
+	bool interlaceB = b.flags & DRM_MODE_FLAG_INTERLACE;
+	if (interlaceA != interlaceB)
+		return !interlaceA;
+	if (a.vrefresh != b.vrefresh)
+		return a.vrefresh > b.vrefresh;
+	return (a.type & DRM_MODE_TYPE_PREFERRED) && !(b.type & DRM_MODE_TYPE_PREFERRED);
+}
 
-	for (j=0; j < mConnectorPtr->count_props; j++)
+static bool sameMode(const drmModeModeInfo &a, const drmModeModeInfo &b)
+{
+	return a.hdisplay == b.hdisplay && a.vdisplay == b.vdisplay && a.vrefresh == b.vrefresh &&
+	       (a.flags & DRM_MODE_FLAG_INTERLACE) == (b.flags & DRM_MODE_FLAG_INTERLACE);
+}
+
+void DrmConnector::buildModeTable()
+{
+	mModeIndex.clear();
+	mSupportedSizes.clear();
+	mRefreshRates.clear();
+	mPreferredMode = -1;
+	mMinMode = -1;
+	mMaxMode = -1;
+	mStateSignature = 14695981039346656037ULL;
+	if (!mConnectorPtr)
 	{
-		props = drmModeGetProperty(mDrmModulefd, mConnectorPtr->props[j]);
+		return;
+	}
+
+	//The kernel does not promise any order and lists the same timing more than
+	//once (e.g. CEA and DMT 1080p60), so sort and deduplicate once per probe
+	std::stable_sort(mModes.begin(), mModes.end(), modeBefore);
+	mModes.erase(std::unique(mModes.begin(), mModes.end(), sameMode), mModes.end());
 
-		if (props) {
+	hashValue(mStateSignature, mConnectorPtr->connection);
+	hashValue(mStateSignature, mModes.size());
 
-			if (std::string(props->name) == "EDID")
+	for (size_t i = 0; i < mModes.size(); i++)
+	{
+		const drmModeModeInfo &mode = mModes[i];
+		int index = static_cast<int>(i);
+		bool interlace = mode.flags & DRM_MODE_FLAG_INTERLACE;
+		if (mPreferredMode < 0 && (mode.type & DRM_MODE_TYPE_PREFERRED))
+		{
+			mPreferredMode = index;
+		}
+		if (!interlace)
+		{
+			if (mMaxMode < 0)
 			{
-				if (props->flags & DRM_MODE_PROP_BLOB) {
-					drmModePropertyBlobPtr blob;
-
-					blob = drmModeGetPropertyBlob(mDrmModulefd, mConnectorPtr->prop_values[j]);
-					if (blob) {
-						Edid edid = Edid((unsigned char*) blob->data, blob->length);
-						drmModeFreePropertyBlob(blob);
-						drmModeFreeProperty(props);
-						return edid;
-					} else {
-						THROW_FATAL_EXCEPTION("error getting edid blob %llu" , mConnectorPtr->prop_values[j]);
-					}
-				}
+				mMaxMode = index;
 			}
-			//TODO:: DPMS property and others.
-			drmModeFreeProperty(props);
+			mMinMode = index;
 		}
+		hashValue(mStateSignature, (uint64_t(mode.clock) << 32) | mode.flags);
+		hashValue(mStateSignature, (uint64_t(mode.hdisplay) << 48) | (uint64_t(mode.htotal) << 32) |
+		                           (uint64_t(mode.vdisplay) << 16) | mode.vtotal);
+
+		mModeIndex.emplace(modeKey(mode.hdisplay, mode.vdisplay, mode.vrefresh, interlace), index);
+		uint64_t sizeKey = modeKey(mode.hdisplay, mode.vdisplay, 0, interlace);
+		//Highest refresh of a size comes first
+		if (mModeIndex.emplace(sizeKey, index).second && !interlace)
+		{
+			AVAL_VIDEO_SIZE_T dim;
+			dim.w = mode.hdisplay;
+			dim.h = mode.vdisplay;
+			mSupportedSizes.push_back(dim);
+		}
+		mRefreshRates[sizeKey].push_back(mode.vrefresh);
 	}
-	return	Edid();
+	if (mPreferredMode >= 0)
+	{
+		const drmModeModeInfo &preferred = mModes[mPreferredMode];
+		mModeIndex[modeKey(preferred.hdisplay, preferred.vdisplay, 0, preferred.flags & DRM_MODE_FLAG_INTERLACE)] = mPreferredMode;
+	}
+	if (mMaxMode < 0 && !mModes.empty())
+	{
+		//Interlaced modes only
+		mMaxMode = 0;
+		mMinMode = static_cast<int>(mModes.size()) - 1;
+	}
+}
+
+bool DrmConnector::getModeRange(DrmDisplayMode &min, DrmDisplayMode &max) const
+{
+	if (!isConnected())
+		return false;
+	max.mModeInfoPtr = const_cast<drmModeModeInfo*>(&mModes[mMaxMode]);
+	min.mModeInfoPtr = const_cast<drmModeModeInfo*>(&mModes[mMinMode]);
+	return true;
+}
+
+bool DrmConnector::getSizeRange(AVAL_VIDEO_SIZE_T &min, AVAL_VIDEO_SIZE_T &max) const
+{
+	if (!isConnected())
+		return false;
+	max.w = mModes[mMaxMode].hdisplay;
+	max.h = mModes[mMaxMode].vdisplay;
+	min.w = mModes[mMinMode].hdisplay;
+	min.h = mModes[mMinMode].vdisplay;
+	return true;
+}
+
+const std::vector<uint32_t>& DrmConnector::getRefreshRates(uint32_t width, uint32_t height, bool interlace) const
+{
+	static const std::vector<uint32_t> none;
+	auto rates = mRefreshRates.find(modeKey(width, height, 0, interlace));
+	return rates == mRefreshRates.end() ? none : rates->second;
+}
+
+DrmDisplayMode DrmConnector::getPreferredMode()
+{
+	if (mPreferredMode < 0)
+	{
+		return DrmDisplayMode();
+	}
+	return DrmDisplayMode(&mModes[mPreferredMode]);
 }
 
-std::vector<AVAL_VIDEO_SIZE_T> DrmConnector::getSupportedModes()
+DrmDisplayMode DrmConnector::getMode(uint32_t width, uint32_t height, uint32_t vRefresh, bool interlace) const
 {
-	std::vector<AVAL_VIDEO_SIZE_T> modeList;
-	if (mConnectorPtr->count_modes)
+	auto mode = mModeIndex.find(modeKey(width, height, vRefresh, interlace));
+	if (mode == mModeIndex.end())
 	{
-		for (int j = 0; j < mConnectorPtr->count_modes; j++)
+		return DrmDisplayMode();
+	}
+	return DrmDisplayMode(const_cast<drmModeModeInfo*>(&mModes[mode->second]));
+}
+
+bool DrmConnector::isModeSupported(uint32_t width, uint32_t height, uint32_t vRefresh, bool interlace) const
+{
+	return mModeIndex.count(modeKey(width, height, vRefresh, interlace)) != 0;
+}
+
+
+
+Edid DrmConnector::getEdid()
+{
+	//EDID property id comes from the device property registry, so only the
+	//blob itself has to be fetched here.
+	if (!edidPropId)
+	{
+		return Edid();
+	}
+
+	for (int j=0; j < mConnectorPtr->count_props; j++)
+	{
+		if (mConnectorPtr->props[j] != edidPropId)
 		{
-			auto mode =  &mConnectorPtr->modes[j];
-			AVAL_VIDEO_SIZE_T dim;
-			dim.w= mode->hdisplay;
-			dim.h = mode->vdisplay;
-			modeList.push_back(dim);
+			continue;
+		}
+		if (!mConnectorPtr->prop_values[j])
+		{
+			break; //no EDID read from the sink
 		}
+
+		drmModePropertyBlobPtr blob = drmModeGetPropertyBlob(mDrmModulefd, mConnectorPtr->prop_values[j]);
+		if (!blob)
+		{
+			//The blob dies with the sink, e.g. unplugged since this snapshot was probed
+			LOG_ERROR(MSGID_DEVICE_ERROR, 0, "%s: no EDID blob %llu: %s", mName.c_str(),
+			          (unsigned long long)mConnectorPtr->prop_values[j], strerror(errno));
+			break;
+		}
+		return Edid(blob); //takes over the blob, no copy
 	}
-	return modeList;
+	return	Edid();
 }
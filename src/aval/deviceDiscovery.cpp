@@ -16,15 +16,17 @@
 
 #include "driElements.h"
 #include <libudev.h>
+#include <poll.h>
+#include <cstdlib>
 #include <sstream>
+#include <glib-unix.h>
 #include "logging.h"
 
 
 static const char* const DEVICE_SUBSYSTEM = "drm";
-static constexpr uint32_t DISPLAY_PLUGGED_POLL_TIMEOUT = 250;
 
 
-DRIElements::UDev::UDev(std::function<void(std::string)> fn):updateFun(fn)
+DRIElements::UDev::UDev(std::function<void(const HotplugEvent&)> fn):updateFun(fn)
 {
 	udev = udev_new();
 	if (!udev)
@@ -37,39 +39,52 @@ DRIElements::UDev::UDev(std::function<void(std::string)> fn):updateFun(fn)
 	fd = udev_monitor_get_fd(mon);
 }
 
-gboolean DRIElements::UDev::pollDRIDevices(gpointer userData)
+DRIElements::UDev::~UDev()
+{
+	udev_monitor_unref(mon);
+	udev_unref(udev);
+}
+
+gboolean DRIElements::UDev::onUdevEvent(gint fd, GIOCondition condition, gpointer userData)
 {
-	fd_set fds;
-	struct timeval tv;
-	int ret;
 	UDev* uDevMonitor = static_cast<UDev*>(userData);
-	FD_ZERO(&fds);
-	FD_SET(uDevMonitor->fd, &fds);
-	tv.tv_sec = 0;
-	tv.tv_usec = 0;
+	if (condition & (G_IO_ERR | G_IO_HUP | G_IO_NVAL))
+	{
+		LOG_ERROR(MSGID_UDEV_ERROR, 0, "udev monitor fd %d closed, hotplug is no longer tracked", fd);
+		return G_SOURCE_REMOVE;
+	}
 
-	ret = select(uDevMonitor->fd + 1, &fds, NULL, NULL, &tv);
-	if (ret > 0 && FD_ISSET(uDevMonitor->fd, &fds))
+	//Drain everything queued so a burst of events is handled in one wakeup
+	struct pollfd pfd = {fd, POLLIN, 0};
+	while (poll(&pfd, 1, 0) > 0 && (pfd.revents & POLLIN))
 	{
 		struct udev_device* dev = udev_monitor_receive_device(uDevMonitor->mon);
-		if (dev)
-		{
-			std::stringstream ss;
-			ss << "Got Device\n" ;
-			std::string node = udev_device_get_devnode(dev);
-			ss << "\n   Node:  "<< node,
-			ss << "\n   Subsystem: " << udev_device_get_subsystem(dev);
-			ss << "\n   Devtype: " << udev_device_get_devtype(dev);
-			ss << "\n   Action: "<< udev_device_get_action(dev);
-			udev_device_unref(dev);
-			LOG_INFO(MSGID_DEVICE_STATUS,0,ss.str().c_str());
-			uDevMonitor->updateFun(node);
-		} else
+		if (!dev)
 		{
 			LOG_ERROR(MSGID_UDEV_ERROR, 0, "No Device from receive_device. An error occured");
+			break;
+		}
+		const char *devnode = udev_device_get_devnode(dev);
+		const char *connector = udev_device_get_property_value(dev, "CONNECTOR");
+		const char *property = udev_device_get_property_value(dev, "PROPERTY");
+		std::string node = devnode ? devnode : "";
+		HotplugEvent event{node, connector ? static_cast<uint32_t>(strtoul(connector, nullptr, 10)) : 0,
+		                   property ? static_cast<uint32_t>(strtoul(property, nullptr, 10)) : 0};
+		std::stringstream ss;
+		ss << "Got Device\n" ;
+		ss << "\n   Node:  "<< node,
+		ss << "\n   Subsystem: " << udev_device_get_subsystem(dev);
+		ss << "\n   Devtype: " << (udev_device_get_devtype(dev) ? udev_device_get_devtype(dev) : "");
+		ss << "\n   Action: "<< (udev_device_get_action(dev) ? udev_device_get_action(dev) : "");
+		ss << "\n   Connector: " << event.connectorId << " Property: " << event.propertyId;
+		udev_device_unref(dev);
+		LOG_INFO(MSGID_DEVICE_STATUS,0,ss.str().c_str());
+		if (!node.empty())
+		{
+			uDevMonitor->updateFun(event);
 		}
 	}
-	return true;
+	return G_SOURCE_CONTINUE;
 }
 
 std::vector<std::string> DRIElements::UDev::getDeviceList()
@@ -103,8 +118,7 @@ std::vector<std::string> DRIElements::UDev::getDeviceList()
 
 }
 
-void DRIElements::setupDevicePolling()
+void DRIElements::setupDeviceMonitor()
 {
-	mTimeOutHandle = g_timeout_add(DISPLAY_PLUGGED_POLL_TIMEOUT,
-	                               DRIElements::UDev::pollDRIDevices, mUDev);
+	mUdevSource = g_unix_fd_add(mUDev->getFd(), G_IO_IN, DRIElements::UDev::onUdevEvent, mUDev);
 }
\ No newline at end of file
@@ -0,0 +1,102 @@
+// Copyright (c) 2017-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+#include <algorithm>
+#include <iterator>
+#include "displayChange.h"
+
+static bool sizeBefore(const AVAL_VIDEO_SIZE_T &a, const AVAL_VIDEO_SIZE_T &b)
+{
+	return a.w != b.w ? a.w < b.w : a.h < b.h;
+}
+
+static bool sameTiming(const drmModeModeInfo &a, const drmModeModeInfo &b)
+{
+	return a.hdisplay == b.hdisplay && a.vdisplay == b.vdisplay && a.vrefresh == b.vrefresh &&
+	       a.clock == b.clock && a.flags == b.flags;
+}
+
+const char* displayChangeName(DisplayChangeType type)
+{
+	switch (type)
+	{
+	case DISPLAY_CONNECTED: return "connected";
+	case DISPLAY_DISCONNECTED: return "disconnected";
+	case DISPLAY_MODES_CHANGED: return "modes changed";
+	case DISPLAY_PREFERRED_CHANGED: return "preferred mode changed";
+	case DISPLAY_EDID_CHANGED: return "EDID changed";
+	}
+	return "unknown";
+}
+
+void diffDisplayState(const std::string &output, const DisplayState &before, const DisplayState &after,
+                      std::vector<DisplayChange> &changes)
+{
+	DisplayChange change;
+	change.output = output;
+
+	if (after.connected && !before.connected)
+	{
+		change.type = DISPLAY_CONNECTED;
+		changes.push_back(change);
+	}
+
+	//Both lists are a few dozen sizes at most, sorted copies keep this linear
+	std::vector<AVAL_VIDEO_SIZE_T> oldSizes(before.sizes);
+	std::vector<AVAL_VIDEO_SIZE_T> newSizes(after.sizes);
+	std::sort(oldSizes.begin(), oldSizes.end(), sizeBefore);
+	std::sort(newSizes.begin(), newSizes.end(), sizeBefore);
+	DisplayChange modes = change;
+	modes.type = DISPLAY_MODES_CHANGED;
+	std::set_difference(oldSizes.begin(), oldSizes.end(), newSizes.begin(), newSizes.end(),
+	                    std::back_inserter(modes.removedSizes), sizeBefore);
+	std::set_difference(newSizes.begin(), newSizes.end(), oldSizes.begin(), oldSizes.end(),
+	                    std::back_inserter(modes.addedSizes), sizeBefore);
+	if (!modes.removedSizes.empty() || !modes.addedSizes.empty())
+	{
+		if (!after.sizes.empty())
+		{
+			modes.maxSize = after.sizes.front();
+			modes.minSize = after.sizes.back();
+		}
+		changes.push_back(modes);
+	}
+
+	if (!sameTiming(before.preferred, after.preferred))
+	{
+		DisplayChange preferred = change;
+		preferred.type = DISPLAY_PREFERRED_CHANGED;
+		preferred.previousPreferred = before.preferred;
+		preferred.preferred = after.preferred;
+		changes.push_back(preferred);
+	}
+
+	if (before.edidHash != after.edidHash)
+	{
+		DisplayChange edid = change;
+		edid.type = DISPLAY_EDID_CHANGED;
+		edid.previousEdidHash = before.edidHash;
+		edid.edidHash = after.edidHash;
+		changes.push_back(edid);
+	}
+
+	if (before.connected && !after.connected)
+	{
+		change.type = DISPLAY_DISCONNECTED;
+		changes.push_back(change);
+	}
+}
@@ -0,0 +1,71 @@
+// Copyright (c) 2017-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <xf86drmMode.h>
+#include <aval/aval_common.h>
+
+//What an output shows to AVAL clients, captured before and after a probe
+struct DisplayState
+{
+	bool connected = false;
+	std::vector<AVAL_VIDEO_SIZE_T> sizes; //progressive, largest first
+	drmModeModeInfo preferred{}; //hdisplay 0 if the sink marked none
+	uint64_t edidHash = 0; //0 without EDID
+};
+
+enum DisplayChangeType
+{
+	DISPLAY_CONNECTED = 0,
+	DISPLAY_DISCONNECTED,
+	DISPLAY_MODES_CHANGED,
+	DISPLAY_PREFERRED_CHANGED,
+	DISPLAY_EDID_CHANGED
+};
+
+//One change of one output. Only the members of its type are set.
+struct DisplayChange
+{
+	DisplayChangeType type;
+	std::string output; //e.g. "HDMI-A-1"
+	bool primary = false; //the output addressed by an empty output name
+
+	//DISPLAY_MODES_CHANGED: sizes no longer and newly supported, and the new range
+	std::vector<AVAL_VIDEO_SIZE_T> removedSizes;
+	std::vector<AVAL_VIDEO_SIZE_T> addedSizes;
+	AVAL_VIDEO_SIZE_T minSize{0, 0};
+	AVAL_VIDEO_SIZE_T maxSize{0, 0};
+
+	//DISPLAY_PREFERRED_CHANGED
+	drmModeModeInfo previousPreferred{};
+	drmModeModeInfo preferred{};
+
+	//DISPLAY_EDID_CHANGED, content hashes as used by the EDID cache
+	uint64_t previousEdidHash = 0;
+	uint64_t edidHash = 0;
+};
+
+const char* displayChangeName(DisplayChangeType type);
+
+//Appends the changes from before to after, in the order connected, modes,
+//preferred, EDID, disconnected. Nothing is appended for equal states.
+void diffDisplayState(const std::string &output, const DisplayState &before, const DisplayState &after,
+                      std::vector<DisplayChange> &changes);
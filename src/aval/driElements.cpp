@@ -17,196 +17,791 @@
 #include <iostream>
 #include <cstring>
 #include <vector>
-#include <sstream>
 #include <algorithm>
 #include <inttypes.h>
 #include <unistd.h>
 #include <glib.h>
+#include <glib-unix.h>
 #include <fcntl.h>
+#include <thread>
 
 #include <drm_fourcc.h>
 #include <aval/aval_video.h>
 #include "driElements.h"
+#include "atomicCommit.h"
+#include "bufferPool.h"
+#include "drmEvents.h"
+#include "modesetWorker.h"
+#include "updateCoalescer.h"
 #include "edid.h"
+#include "config.h"
 
 #define DRM_MODULE "vc4"
 
-DRIElements::DRIElements(AVAL_VIDEO_SIZE_T defMode, std::function<void(AVAL_VIDEO_SIZE_T, AVAL_VIDEO_SIZE_T)> p)
-			:mAvalCallBack(p)
+#ifndef DRM_MODE_FLAG_PIC_AR_MASK //older libdrm headers
+#define DRM_MODE_FLAG_PIC_AR_MASK (0x0F << 19)
+#endif
+
+DRIElements::DRIElements(AVAL_VIDEO_SIZE_T defMode, std::function<void(const DisplayChange&)> listener)
+			:mDisplayListener(listener)
 			,mInitialMode(defMode)
 			,mConfiguredMode(defMode)
+			,mEdidCache(EDID_CACHE_DIR)
 {
-	mUDev = new UDev([this](std::string node){updateDevice(node);});
+	mUDev = new UDev([this](const HotplugEvent &event){queueHotplug(event);});
 	loadResources();
 
-	auto devPair = mDeviceList.begin();
+	auto devPair = mDeviceList.find(mPrimaryDev);
 	if (devPair != mDeviceList.end())
 	{
 		DriDevice& device = devPair->second;
 		device.setupDevice();
 
-		updateDevice(devPair->first);
+		//loadResources already has the modes of every connector
+		updateModeRange(device);
 
 		for (auto& crtc : device.crtcList)
 		{
 			LOG_DEBUG("\n set Active mode for crtc %d %d", crtc.mCrtc->crtc_id, crtc.crtc_index);
-			device.setActiveMode(crtc,device.width,device.height);
+			if (device.setActiveMode(crtc,device.width,device.height))
+			{
+				//Outputs other than the primary one, e.g. a DSI panel, may not
+				//support the configured size. They start with their preferred mode.
+				for (auto connId : crtc.connectors)
+				{
+					auto conn = std::find_if(device.connectorList.begin(), device.connectorList.end(),
+					                         [connId](DrmConnector &c) { return c.mConnectorPtr->connector_id == connId; });
+					DrmDisplayMode preferred = conn != device.connectorList.end() ? conn->getPreferredMode() : DrmDisplayMode();
+					if (preferred.mModeInfoPtr)
+					{
+						device.setActiveMode(crtc, preferred.mModeInfoPtr->hdisplay, preferred.mModeInfoPtr->vdisplay,
+						                     preferred.mModeInfoPtr->vrefresh);
+						break;
+					}
+				}
+			}
+		}
+		mCoalescer.reset(new PlaneUpdateCoalescer(device));
+	}
+	mModesetWorker.reset(new ModesetWorker());
+	for (auto &dev : mDeviceList)
+	{
+		verifyModes(dev.first);
+	}
+	setupDeviceMonitor();
+	setupDrmEvents();
+	setupMemoryPressure();
+}
+
+void DRIElements::setScanoutFbCacheBudget(size_t bytes)
+{
+	for (auto &devPair : mDeviceList)
+	{
+		devPair.second.fbCache.setBudget(devPair.second.drmModuleFd, bytes);
+	}
+}
+
+void DRIElements::setupMemoryPressure()
+{
+	//PSI trigger: wake up when tasks stalled on memory for 150ms within 2s.
+	//Unprivileged triggers need a window that is a multiple of 2s.
+	mPressureFd = open("/proc/pressure/memory", O_RDWR | O_NONBLOCK | O_CLOEXEC);
+	if (mPressureFd < 0)
+	{
+		LOG_DEBUG("No memory pressure information: %s", strerror(errno));
+		return;
+	}
+	const char trigger[] = "some 150000 2000000";
+	if (write(mPressureFd, trigger, sizeof(trigger)) < 0)
+	{
+		LOG_DEBUG("Memory pressure trigger rejected: %s", strerror(errno));
+		close(mPressureFd);
+		mPressureFd = -1;
+		return;
+	}
+	mPressureSource = g_unix_fd_add(mPressureFd, G_IO_PRI, [](gint fd, GIOCondition condition, gpointer userData) -> gboolean
+	{
+		if (condition & G_IO_ERR)
+		{
+			return G_SOURCE_REMOVE;
+		}
+		DumbBufferPool &pool = DumbBufferPool::instance();
+		DumbBufferPoolStats stats = pool.stats();
+		if (stats.retainedBuffers)
+		{
+			LOG_INFO(MSGID_DEVICE_STATUS, 0, "Memory pressure, releasing %zu idle dumb buffers (%zu KiB)",
+			         stats.retainedBuffers, stats.retainedBytes >> 10);
+			pool.trim(0);
+		}
+		return G_SOURCE_CONTINUE;
+	}, nullptr);
+}
+
+void DRIElements::setBufferPoolBudget(size_t bytes)
+{
+	DumbBufferPool::instance().setBudget(bytes);
+}
+
+bool DRIElements::importDmabuf(const DmabufFrame &frame, uint32_t &fbId)
+{
+	auto devPair = mDeviceList.find(mPrimaryDev);
+	if (devPair == mDeviceList.end())
+	{
+		return false;
+	}
+	int ret = devPair->second.prime.import(devPair->second.drmModuleFd, frame, fbId);
+	if (ret)
+	{
+		LOG_ERROR(MSGID_FB_CREATION_FAILED, 0, "Cannot scan out %ux%u dma-buf: %s", frame.width, frame.height,
+		          strerror(-ret));
+		return false;
+	}
+	return true;
+}
+
+void DRIElements::releaseDmabuf(uint32_t fbId)
+{
+	auto devPair = mDeviceList.find(mPrimaryDev);
+	if (devPair != mDeviceList.end())
+	{
+		devPair->second.prime.release(devPair->second.drmModuleFd, fbId);
+	}
+}
+
+void DRIElements::setupDrmEvents()
+{
+	for (auto &devPair : mDeviceList)
+	{
+		if (devPair.second.drmModuleFd >= 0)
+		{
+			mDrmEventSources.push_back(g_unix_fd_add(devPair.second.drmModuleFd, G_IO_IN,
+			                                         dispatchDrmEvents, nullptr));
 		}
-		mPrimaryDev = devPair->first;
 	}
-	setupDevicePolling();
 }
 
 void DRIElements::loadResources()
 {
-	std::vector<std::string> uDevices = mUDev->getDeviceList();
-	for (auto node : uDevices)
+	std::vector<DriDevice*> cards;
+	for (auto node : mUDev->getDeviceList())
 	{
-		std::string udevNode = node;
-		if (udevNode.find("card") == udevNode.npos)
+		if (node.find("card") == node.npos)
 		{
 			continue;
 		}
+		mDeviceList.emplace(std::piecewise_construct, std::make_tuple(node), std::make_tuple());
+		DriDevice& device = mDeviceList[node];
+		device.deviceName = node;
+		cards.push_back(&device);
+	}
+	if (cards.empty())
+	{
+		return;
+	}
 
-		//mDeviceList.emplace(udevNode, DriDevice{});
-		mDeviceList.emplace(std::piecewise_construct, std::make_tuple(udevNode), std::make_tuple());
-		DriDevice& device = mDeviceList[udevNode];
-		device.deviceName = udevNode;
-		device.drmModuleFd = open(udevNode.c_str(), O_RDWR | O_CLOEXEC);
-		if (device.drmModuleFd < 0)
+	//Cards are independent, so a slow one (DDC probe, USB display) does not hold
+	//up the others. Each thread fills in only its own entry, the map itself is
+	//not touched until all of them are done.
+	gint64 start = g_get_monotonic_time();
+	std::vector<char> loaded(cards.size(), 0);
+	auto load = [this, &cards, &loaded](size_t i)
+	{
+		gint64 cardStart = g_get_monotonic_time();
+		try
 		{
-			//THROW_FATAL_EXCEPTION("Failed to open the card %d", udevNode);
-			LOG_ERROR(MSGID_DEVICE_ERROR,0, "Failed to open  %d", udevNode);
+			loaded[i] = loadCard(*cards[i]);
 		}
+		catch (const std::exception &e)
+		{
+			LOG_ERROR(MSGID_DEVICE_ERROR, 0, "Enumerating %s failed: %s", cards[i]->deviceName.c_str(), e.what());
+		}
+		LOG_INFO(MSGID_DEVICE_STATUS, 0, "%s enumerated in %" PRId64 " us", cards[i]->deviceName.c_str(),
+		         static_cast<int64_t>(g_get_monotonic_time() - cardStart));
+	};
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < cards.size(); i++)
+	{
+		threads.emplace_back(load, i);
+	}
+	load(0);
+	for (auto &thread : threads)
+	{
+		thread.join();
+	}
 
-		drmModeResPtr res = drmModeGetResources(device.drmModuleFd);
-		if (!res)
+	//Publish the cards that came up completely, the first vc4 one is the primary
+	size_t count = 0;
+	for (size_t i = 0; i < cards.size(); i++)
+	{
+		std::string name = cards[i]->deviceName;
+		if (!loaded[i])
 		{
-			LOG_ERROR(MSGID_DEVICE_ERROR,0,"Failed to get drm resources for %s", device.deviceName);
+			mDeviceList.erase(name); //closes the card and frees whatever was read
+			continue;
+		}
+		count++;
+		if (mPrimaryDev.empty() || (cards[i]->driverName == DRM_MODULE && mDeviceList[mPrimaryDev].driverName != DRM_MODULE))
+		{
+			mPrimaryDev = name;
 		}
+	}
+	LOG_INFO(MSGID_DEVICE_STATUS, 0, "Enumerated %zu of %zu cards in %" PRId64 " us", count, cards.size(),
+	         static_cast<int64_t>(g_get_monotonic_time() - start));
+}
+
+bool DRIElements::loadCard(DriDevice &device)
+{
+	const char *node = device.deviceName.c_str();
+	device.drmModuleFd = open(node, O_RDWR | O_CLOEXEC);
+	if (device.drmModuleFd < 0)
+	{
+		LOG_ERROR(MSGID_DEVICE_ERROR, 0, "Failed to open %s: %s", node, strerror(errno));
+		return false;
+	}
+	drmVersionPtr version = drmGetVersion(device.drmModuleFd);
+	if (version)
+	{
+		device.driverName.assign(version->name, version->name_len);
+		drmFreeVersion(version);
+	}
+
+	//Atomic implies universal planes, so primary planes show up in the plane list from now on.
+	device.atomicSupported = !drmSetClientCap(device.drmModuleFd, DRM_CLIENT_CAP_ATOMIC, 1);
+	LOG_INFO(MSGID_DEVICE_STATUS, 0, "%s (%s) uses %s modesetting", node, device.driverName.c_str(),
+	         device.atomicSupported ? "atomic" : "legacy");
+
+	drmModeResPtr res = drmModeGetResources(device.drmModuleFd);
+	if (!res)
+	{
+		//Render only nodes and some USB displays have no KMS resources
+		LOG_ERROR(MSGID_DEVICE_ERROR, 0, "Failed to get drm resources for %s: %s", node, strerror(errno));
+		return false;
+	}
 
-		//build crtc list
-		for (int i = 0; i < res->count_crtcs; i++)
+	//build crtc list
+	for (int i = 0; i < res->count_crtcs; i++)
+	{
+		drmModeCrtc *crtc = device.resources.adopt(drmModeGetCrtc(device.drmModuleFd, res->crtcs[i]));
+		if (!crtc)
 		{
-			DrmCrtc drmCrtc(drmModeGetCrtc(device.drmModuleFd, res->crtcs[i]), static_cast<uint32_t>(i));
-			device.crtcList.push_back(drmCrtc);
+			LOG_ERROR(MSGID_DEVICE_ERROR, 0, "Failed to get crtc %u of %s", res->crtcs[i], node);
+			drmModeFreeResources(res);
+			return false;
 		}
-		//build connector list
-		for (int i = 0; i < res->count_connectors; i++)
+		device.crtcList.emplace_back(crtc, static_cast<uint32_t>(i));
+	}
+	//build connector list. A full probe can take a DDC read per connector,
+	//so only read what the kernel knows and leave probing to restoreModes.
+	for (int i = 0; i < res->count_connectors; i++)
+	{
+		drmModeConnector* connector = drmModeGetConnectorCurrent(device.drmModuleFd, res->connectors[i]);
+		DrmConnector::sCurrentReads++;
+		if (!connector)
 		{
-			drmModeConnector* connector = drmModeGetConnector(device.drmModuleFd, res->connectors[i]);
-			DrmConnector drmConnector(device.drmModuleFd, connector);
-			device.connectorList.push_back(drmConnector);
+			//Hot-removed since drmModeGetResources, e.g. a DP MST branch
+			LOG_ERROR(MSGID_DEVICE_ERROR, 0, "Skipping connector %u of %s: %s", res->connectors[i], node,
+			          strerror(errno));
+			continue;
 		}
+		device.connectorList.emplace_back(device.drmModuleFd, connector);
+	}
 
-		//build encoder list
-		for (int i = 0; i < res->count_encoders; i++)
+	//build encoder list
+	for (int i = 0; i < res->count_encoders; i++)
+	{
+		device.encoderList.emplace_back(device.resources.adopt(drmModeGetEncoder(device.drmModuleFd, res->encoders[i])));
+	}
+	drmModeFreeResources(res);
+
+	//build plane list
+	drmModePlaneResPtr planeRes = drmModeGetPlaneResources(device.drmModuleFd);
+	if (!planeRes)
+	{
+		LOG_ERROR(MSGID_DEVICE_ERROR, 0, "drmModeGetPlaneResources failed for %s: %s", node, strerror(errno));
+		return false;
+	}
+	for (size_t i = 0; i < planeRes->count_planes; i++)
+	{
+		drmModePlane* plane = device.resources.adopt(drmModeGetPlane(device.drmModuleFd, planeRes->planes[i]));
+		if (!plane)
 		{
-			DrmEncoder drmEncoder(drmModeGetEncoder(device.drmModuleFd, res->encoders[i]));
-			device.encoderList.push_back(drmEncoder);
+			LOG_ERROR(MSGID_DEVICE_ERROR, 0, "Failed to get plane %u of %s", planeRes->planes[i], node);
+			continue;
 		}
+		device.planeList.emplace_back(plane);
+	}
+	drmModeFreePlaneResources(planeRes);
+
+	device.loadProperties();
+	for (auto &conn : device.connectorList)
+	{
+		restoreModes(device, conn);
+	}
+	return true;
+}
+
+void DRIElements::restoreModes(DriDevice &device, DrmConnector &conn)
+{
+	uint32_t connId = conn.mConnectorPtr->connector_id;
+	conn.updateEdidHash();
+	if (conn.mConnectorPtr->connection == DRM_MODE_DISCONNECTED || conn.isConnected())
+	{
+		return; //the kernel already knows, verifyModes confirms it
+	}
+
+	//The kernel reads the EDID in the same probe that fills the modes, so
+	//serve whatever sink this output had last time, verifyModes checks it
+	EdidModeTable table;
+	uint64_t edidHash = 0;
+	if (conn.mConnectorPtr->connection == DRM_MODE_CONNECTED &&
+	    mEdidCache.loadLast(edidCacheKey(device, conn), table, edidHash) && !table.modes.empty())
+	{
+		LOG_INFO(MSGID_DEVICE_STATUS, 0, "%s: %zu modes from EDID cache", conn.getName().c_str(), table.modes.size());
+		conn.useCachedModes(table);
+		conn.mEdidHash = edidHash;
+		return;
+	}
+
+	//Nothing to offer without a probe
+	conn.refresh(true);
+	device.properties.load(device.drmModuleFd, connId, DRM_MODE_OBJECT_CONNECTOR);
+	conn.updateEdidHash();
+	storeModes(device, conn);
+}
 
-		//build plane list
-		drmModePlaneResPtr planeRes = drmModeGetPlaneResources(device.drmModuleFd);
+std::string DRIElements::edidCacheKey(DriDevice &device, DrmConnector &conn)
+{
+	//Card numbers depend on probe order, driver and output name do not
+	return device.driverName + "-" + conn.getOutputName();
+}
 
-		if (!planeRes)
+void DRIElements::storeModes(DriDevice &device, DrmConnector &conn)
+{
+	if (!conn.isConnected() || conn.hasCachedModes())
+	{
+		return;
+	}
+	Edid edid = conn.getEdid();
+	if (!edid.size())
+	{
+		return; //nothing to key the entry by
+	}
+	EdidModeTable table = conn.getModeTable();
+	EdidModeTable stored;
+	if (mEdidCache.load(edid.data(), edid.size(), stored) && stored.preferred == table.preferred &&
+	    stored.modes.size() == table.modes.size() &&
+	    !memcmp(stored.modes.data(), table.modes.data(), table.modes.size() * sizeof(drmModeModeInfo)))
+	{
+		//Known sink, maybe new on this output
+		mEdidCache.remember(edidCacheKey(device, conn), EdidCache::hash(edid.data(), edid.size()));
+		return; //spare the flash
+	}
+	if (mEdidCache.store(edidCacheKey(device, conn), edid.data(), edid.size(), table))
+	{
+		char sink[14];
+		char vendor[4];
+		EdidView view = edid.view();
+		view.manufacturer(vendor);
+		if (!view.monitorName(sink, sizeof(sink)))
 		{
-			LOG_ERROR(MSGID_DEVICE_ERROR,0,"drmModeGetPlaneResources failed: %s\n",
-			          strerror(errno));
+			snprintf(sink, sizeof(sink), "%s %04x", vendor, view.productCode());
 		}
+		LOG_INFO(MSGID_DEVICE_STATUS, 0, "Cached %zu modes of %s on %s", table.modes.size(), sink, conn.getName().c_str());
+	}
+}
 
+void DRIElements::verifyModes(const std::string &name)
+{
+	DriDevice &device = mDeviceList[name];
+	typedef DrmObjectPtr<drmModeConnector> ConnectorPtr;
+	auto probed = std::make_shared<std::vector<ConnectorPtr>>();
+	std::vector<uint32_t> connIds;
+	for (auto &conn : device.connectorList)
+	{
+		connIds.push_back(conn.mConnectorPtr->connector_id);
+	}
+	int fd = device.drmModuleFd;
+	uint32_t generation = device.probeGeneration;
+
+	mModesetWorker->post([fd, connIds, probed]
+	{
+		for (uint32_t connId : connIds)
+		{
+			probed->push_back(ConnectorPtr(drmModeGetConnector(fd, connId)));
+		}
+	}, [this, name, probed, generation]
+	{
+		auto devPair = mDeviceList.find(name);
+		if (devPair == mDeviceList.end())
+		{
+			return;
+		}
+		DriDevice &device = devPair->second;
+		if (device.probeGeneration != generation)
+		{
+			LOG_DEBUG("%s was probed on hotplug, dropping the boot verification", name.c_str());
+			return;
+		}
+		std::vector<DisplayChange> changes;
+		for (auto &fresh : *probed)
+		{
+			if (!fresh)
+			{
+				LOG_ERROR(MSGID_DEVICE_ERROR, 0, "Failed to probe a connector of %s", name.c_str());
+				continue;
+			}
+			DrmConnector::sFullProbes++;
+			uint32_t connId = fresh->connector_id;
+			auto conn = std::find_if(device.connectorList.begin(), device.connectorList.end(),
+			                         [connId](DrmConnector &c) { return c.mConnectorPtr->connector_id == connId; });
+			if (conn == device.connectorList.end())
+			{
+				continue;
+			}
+			uint64_t before = conn->stateSignature();
+			bool fromCache = conn->hasCachedModes();
+			DisplayState state = conn->displayState();
+			conn->adopt(fresh.release());
+			device.properties.load(device.drmModuleFd, connId, DRM_MODE_OBJECT_CONNECTOR);
+			conn->updateEdidHash();
+			//Hash 0: no EDID could be read, nothing to compare
+			if (fromCache && conn->mEdidHash && conn->mEdidHash != state.edidHash)
+			{
+				LOG_INFO(MSGID_DEVICE_STATUS, 0, "%s has another sink than its cached modes were read from",
+				         conn->getName().c_str());
+			}
+			else if (conn->stateSignature() != before)
+			{
+				LOG_INFO(MSGID_DEVICE_STATUS, 0, "%s changed since its modes were cached", conn->getName().c_str());
+			}
+			storeModes(device, *conn);
+			diffDisplayState(conn->getOutputName(), state, conn->displayState(), changes);
+		}
+		if (!changes.empty())
+		{
+			updateModeRange(device);
+			notifyChanges(device, changes);
+		}
+	});
+}
+
+void DRIElements::queueHotplug(const HotplugEvent &event) //callback from udev
+{
+	PendingHotplug &pending = mPendingHotplug[event.node];
+	if (event.connectorId)
+	{
+		pending.connectors.insert(event.connectorId);
+	}
+	else
+	{
+		pending.allConnectors = true;
+	}
+	if (!event.propertyId)
+	{
+		pending.propertyOnly = false;
+	}
 
-		for (size_t i = 0; i < planeRes->count_planes; i++)
+	//Restart the window on every event, but never hold a storm back for more than a few windows
+	gint64 now = g_get_monotonic_time();
+	if (mHotplugSource)
+	{
+		if (now - mHotplugFirstEvent >= gint64(mHotplugDebounceMs) * 1000 * 4)
 		{
-			drmModePlane* plane = drmModeGetPlane(device.drmModuleFd, planeRes->planes[i]);
-			DrmPlane drmPlane(plane);
-			device.planeList.push_back(drmPlane);
+			return;
 		}
+		g_source_remove(mHotplugSource);
+	}
+	else
+	{
+		mHotplugFirstEvent = now;
+	}
+	mHotplugSource = g_timeout_add(mHotplugDebounceMs, DRIElements::flushHotplug, this);
+}
 
+gboolean DRIElements::flushHotplug(gpointer userData)
+{
+	DRIElements *self = static_cast<DRIElements*>(userData);
+	self->mHotplugSource = 0;
+	std::map<std::string, PendingHotplug> pending;
+	pending.swap(self->mPendingHotplug);
+	for (auto &entry : pending)
+	{
+		self->updateDevice(entry.first, entry.second.allConnectors ? std::set<uint32_t>() : entry.second.connectors,
+		                   !entry.second.propertyOnly);
 	}
+	return G_SOURCE_REMOVE;
 }
 
-void DRIElements::updateDevice(std::string name) //callback from udev
+void DRIElements::updateDevice(std::string name, const std::set<uint32_t> &connectorIds, bool fullProbe, bool force)
 {
 
 	LOG_DEBUG("Update device called \n************************\n");
-	AVAL_VIDEO_SIZE_T maxSize, minSize;
 	auto devPair = mDeviceList.find(name);
 	if ( devPair != mDeviceList.end())
 	{
-		AVAL_VIDEO_SIZE_T confMode;
 		DriDevice& device = devPair->second;
-		if (mConfiguredMode.w != mInitialMode.w || mConfiguredMode.h != mInitialMode.h)
+		//Only tell AVAL what it can see (connection, modes, EDID) and what actually changed
+		std::vector<DisplayChange> changes;
+		if (!device.probeConnectors(connectorIds, fullProbe, &changes) && !force)
 		{
-			confMode.w = mInitialMode.w;
-			confMode.h = mInitialMode.h;
+			LOG_DEBUG("No connector state change on %s", name.c_str());
+			return;
 		}
-		else
+		if (fullProbe)
 		{
-			confMode.w = mConfiguredMode.w;
-			confMode.h = mConfiguredMode.h;
+			for (auto &conn : device.connectorList)
+			{
+				storeModes(device, conn);
+			}
 		}
+		updateModeRange(device);
+		notifyChanges(device, changes);
+	} else{
+		LOG_ERROR(MSGID_DEVICE_ERROR, 0, "Cannot handle new DRM device detected %s", name.c_str());
+	}
+}
 
-		device.geModeRange(minSize, maxSize);
-		if ((maxSize.w < confMode.w|| maxSize.h < confMode.h) &&
-		    maxSize.w!=0 && maxSize.h !=0)
+void DRIElements::updateModeRange(DriDevice &device)
+{
+	AVAL_VIDEO_SIZE_T maxSize{0, 0}, minSize{0, 0};
+	AVAL_VIDEO_SIZE_T confMode;
+	if (mConfiguredMode.w != mInitialMode.w || mConfiguredMode.h != mInitialMode.h)
+	{
+		confMode.w = mInitialMode.w;
+		confMode.h = mInitialMode.h;
+	}
+	else
+	{
+		confMode.w = mConfiguredMode.w;
+		confMode.h = mConfiguredMode.h;
+	}
+
+	device.geModeRange(minSize, maxSize);
+	if ((maxSize.w < confMode.w|| maxSize.h < confMode.h) &&
+	    maxSize.w!=0 && maxSize.h !=0)
+	{
+		device.width = maxSize.w;
+		device.height = maxSize.h;
+	}
+	else
+	{
+		device.width = confMode.w;
+		device.height = confMode.h;
+	}
+
+	mLayoutCache.clear();
+}
+
+void DRIElements::notifyChanges(DriDevice &device, std::vector<DisplayChange> &changes)
+{
+	std::string primary;
+	DrmConnector *conn = device.findOutput(std::string());
+	if (conn && device.deviceName == mPrimaryDev)
+	{
+		primary = conn->getOutputName();
+	}
+	for (auto &change : changes)
+	{
+		change.primary = !primary.empty() && change.output == primary;
+		LOG_INFO(MSGID_DEVICE_STATUS, 0, "%s: %s", change.output.c_str(), displayChangeName(change.type));
+		if (mDisplayListener)
 		{
-			device.width = maxSize.w;
-			device.height = maxSize.h;
+			mDisplayListener(change);
 		}
-		else
+	}
+}
+
+std::vector<std::string> DRIElements::getOutputs()
+{
+	std::vector<std::string> outputs;
+	auto devPair = mDeviceList.find(mPrimaryDev);
+	if (devPair == mDeviceList.end())
+	{
+		return outputs;
+	}
+	for (auto &conn : devPair->second.connectorList)
+	{
+		if (conn.crtc_id)
 		{
-			device.width = confMode.w;
-			device.height = confMode.h;
+			outputs.push_back(conn.getOutputName());
 		}
+	}
+	return outputs;
+}
 
-		mAvalCallBack(minSize, maxSize);
+DrmCrtc* DRIElements::outputCrtc(DriDevice &device, const std::string &output)
+{
+	DrmConnector *conn = device.findOutput(output);
+	DrmCrtc *crtc = conn ? device.findCrtcById(conn->crtc_id) : nullptr;
+	if (!crtc)
+	{
+		LOG_ERROR(MSGID_DEVICE_ERROR, 0, "No crtc drives output '%s'", output.c_str());
+	}
+	return crtc;
+}
 
+int DRIElements::changeMode(uint32_t width, uint32_t height, uint32_t vRefresh, const std::string &output)
+{
+	//RPI has Single card, so use device
+	DriDevice &device = mDeviceList[mPrimaryDev];
+	DrmCrtc *crtc = outputCrtc(device, output);
+	if (!crtc)
+	{
+		return false;
+	}
+	auto modeset = mOutputModesets.find(crtc->mCrtc->crtc_id);
+	if (modeset != mOutputModesets.end() && modeset->second.inFlight)
+	{
+		LOG_ERROR(MSGID_MODE_CHANGE_FAILED, 0, "Asynchronous mode change in progress on crtc %u, %ux%u rejected",
+		          crtc->mCrtc->crtc_id, width, height);
+		return false;
+	}
+	if (crtc->hasActiveMode(width, height, vRefresh))
+	{
+		LOG_DEBUG("%ux%u already active on crtc %d", width, height, crtc->mCrtc->crtc_id);
+		return true;
+	}
+	if (!device.setActiveMode(*crtc, width, height, vRefresh))
+	{
+		modeChanged(device, *crtc, width, height);
+		return true;
+	}
+	return false;
+}
 
-	} else{
-		LOG_ERROR(MSGID_DEVICE_ERROR, 0, "Cannot handle new DRM device detected %s", name.c_str());
+//Call a mode change callback from the main loop. Not through a worker, where
+//an EDID verification could hold it up behind a DDC probe.
+static void reportModeChange(std::function<void(bool)> done, bool ok)
+{
+	if (!done)
+	{
+		return;
 	}
+	auto report = new std::function<void()>([done, ok] { done(ok); });
+	g_idle_add_full(G_PRIORITY_DEFAULT_IDLE, [](gpointer data) -> gboolean
+	{
+		(*static_cast<std::function<void()>*>(data))();
+		return G_SOURCE_REMOVE;
+	}, report, [](gpointer data) { delete static_cast<std::function<void()>*>(data); });
 }
 
-int DRIElements::changeMode(uint32_t width, uint32_t height, uint32_t vRefresh)
+bool DRIElements::changeModeAsync(uint32_t width, uint32_t height, uint32_t vRefresh, std::function<void(bool)> done,
+                                  const std::string &output)
+{
+	if (mPrimaryDev.empty())
+	{
+		return false;
+	}
+	DrmCrtc *crtc = outputCrtc(mDeviceList[mPrimaryDev], output);
+	if (!crtc)
+	{
+		return false;
+	}
+	const uint32_t crtcId = crtc->mCrtc->crtc_id;
+	OutputModeset &modeset = mOutputModesets[crtcId];
+	if (modeset.inFlight)
+	{
+		//Only the latest request matters, it starts once the current modeset finished
+		if (modeset.next.done)
+		{
+			std::function<void(bool)> superseded = modeset.next.done;
+			reportModeChange(superseded, false);
+		}
+		modeset.next = PendingModeChange{width, height, vRefresh, done, true};
+		return true;
+	}
+	startModeChange(crtcId, width, height, vRefresh, done);
+	return true;
+}
+
+void DRIElements::startModeChange(uint32_t crtcId, uint32_t width, uint32_t height, uint32_t vRefresh,
+                                  std::function<void(bool)> done)
 {
-	//RPI has Single card, so use device
 	DriDevice &device = mDeviceList[mPrimaryDev];
-	//TODO:: When DSI1 crtc is also active/connected, changemode must be facilitate
-	//changeMode api must change to either accept connector name or crtc id
-	for (auto &crtc : device.crtcList)
+	DrmCrtc *crtc = device.findCrtcById(crtcId);
+	auto req = std::make_shared<ModesetRequest>();
+
+	int ret = -1;
+	if (crtc)
+	{
+		ret = crtc->hasActiveMode(width, height, vRefresh) ? 1 : device.prepareModeset(*crtc, width, height, vRefresh, *req);
+	}
+	if (ret)
 	{
-		//TODO::No need to iterate through crtc for now. remember crtc for hdmi
-		if (!device.setActiveMode(crtc,width,height))
+		//Nothing to commit, still report from the main loop like a real modeset
+		bool ok = ret > 0;
+		if (ok && req->crtc)
 		{
-			//TODO:: Once set this value is not used .. remove it?
-			device.width = width;
-			device.height = height;
-			//change mConfigResolution instead
-			mConfiguredMode.h = height;
-			mConfiguredMode.w = width;
-			return true;
+			modeChanged(device, *crtc, width, height);
 		}
+		reportModeChange(done, ok);
+		return;
 	}
-	return false;
+
+	//Link training can take hundreds of ms. Window updates and modesets on other
+	//crtcs go on, those for this crtc stay queued until the new mode is up.
+	OutputModeset &modeset = mOutputModesets[crtcId];
+	if (!modeset.worker)
+	{
+		modeset.worker.reset(new ModesetWorker());
+	}
+	modeset.inFlight = true;
+	if (mCoalescer)
+	{
+		mCoalescer->hold(crtcId, true);
+	}
+	DriDevice *dev = &device;
+	modeset.worker->post([dev, req] { req->result = dev->commitModeset(*req); },
+	                     [this, dev, req, crtcId, width, height, done]
+	{
+		bool ok = !dev->finishModeset(*req);
+		if (ok)
+		{
+			modeChanged(*dev, *req->crtc, width, height);
+		}
+		if (mCoalescer)
+		{
+			mCoalescer->hold(crtcId, false);
+		}
+		OutputModeset &modeset = mOutputModesets[crtcId];
+		modeset.inFlight = false;
+		if (done)
+		{
+			done(ok);
+		}
+		if (modeset.next.valid)
+		{
+			PendingModeChange next = modeset.next;
+			modeset.next = PendingModeChange{0, 0, 0, nullptr, false};
+			startModeChange(crtcId, next.width, next.height, next.vRefresh, next.done);
+		}
+	});
+}
+
+void DRIElements::modeChanged(DriDevice &device, DrmCrtc &crtc, uint32_t width, uint32_t height)
+{
+	mLayoutCache.clear();
+	//The configured mode and the device size follow the primary output only
+	DrmConnector *primary = device.findOutput(std::string());
+	if (!primary || primary->crtc_id != crtc.mCrtc->crtc_id)
+	{
+		return;
+	}
+	//TODO:: Once set this value is not used .. remove it?
+	device.width = width;
+	device.height = height;
+	//change mConfigResolution instead
+	mConfiguredMode.h = height;
+	mConfiguredMode.w = width;
 }
 
 int DriDevice::geModeRange(AVAL_VIDEO_SIZE_T &minSize, AVAL_VIDEO_SIZE_T &maxSize)
 {
 	//Get the min and max from first connector to notify aval
 	auto conn = connectorList.begin();
-	if (conn->isPlugged())
+	if (conn != connectorList.end() && conn->getSizeRange(minSize, maxSize))
 	{
-		LOG_DEBUG("isPlugged returned true ");
-		DrmDisplayMode min, max;
-		conn->getModeRange(min,max);
-		maxSize.w = min.mModeInfoPtr->hdisplay;
-		maxSize.h = min.mModeInfoPtr->vdisplay;
-
-		minSize.w = max.mModeInfoPtr->hdisplay;
-		minSize.h = max.mModeInfoPtr->vdisplay;
 		LOG_DEBUG("\n max: %d x %d min: %d x %d", maxSize.w, maxSize.h, minSize.w,minSize.h);
-
 		return 0;
 	}
 	return -1;
@@ -215,6 +810,7 @@ int DriDevice::geModeRange(AVAL_VIDEO_SIZE_T &minSize, AVAL_VIDEO_SIZE_T &maxSiz
 int DriDevice::setupDevice()
 {
 	hasDumbBuff();
+	prime.probe(drmModuleFd);
 
 	for (auto& conn : connectorList)
 	{
@@ -235,119 +831,636 @@ int DriDevice::setupDevice()
 		auto crtc = std::find_if (crtcList.begin(), crtcList.end(), [crtcId](DrmCrtc& c){ return c.mCrtc->crtc_id == crtcId; });
 		if (crtc !=  crtcList.end())
 		{
-			crtc->connectors.insert(connId);
+			crtc->connectors.insert(connId);
+		}
+	}
+
+	//Atomic modeset attaches the scanout fb through the primary plane of the crtc
+	for (auto& crtc : crtcList)
+	{
+		for (auto& plane : planeList)
+		{
+			if (plane.type == DRM_PLANE_TYPE_PRIMARY &&
+			    (plane.mDrmPlane->possible_crtcs & (1 << crtc.crtc_index)))
+			{
+				crtc.primaryPlaneId = plane.mDrmPlane->plane_id;
+				break;
+			}
+		}
+	}
+	buildPlanePools();
+	negotiateScanoutFormats();
+	return 0;
+}
+
+uint32_t DriDevice::findCrtc(DrmConnector &conn)
+{
+	drmModeEncoder *enc = nullptr;
+	int32_t crtc = 0;
+	/* try the currently conected encoder+crtc */
+	if (conn.mConnectorPtr->encoder_id)
+	{
+		enc = drmModeGetEncoder(drmModuleFd, conn.mConnectorPtr->encoder_id);
+	}
+	if (enc)
+	{
+		if (enc->crtc_id)
+		{
+			crtc = enc->crtc_id;
+
+		}
+		drmModeFreeEncoder(enc);
+		return crtc;
+	}
+
+	drmModeResPtr res = drmModeGetResources(drmModuleFd);
+
+	/* if connector does not have encoder+crtc connected*/
+	for (int i=0; i< conn.mConnectorPtr->count_encoders; i++)
+	{
+		enc =  drmModeGetEncoder(drmModuleFd,  conn.mConnectorPtr->encoders[i]);
+		if (!enc)
+		{
+			LOG_DEBUG("encoder associated with connector not found");
+			continue;
+		}
+		for (int j=0; j< res->count_crtcs; j++)
+		{
+			if (!(enc->possible_crtcs & (1 << j)))
+			{
+				continue;
+			}
+			crtc = res->crtcs[j];
+			if (crtc >= 0) {
+				break;
+			}
+		}
+		drmModeFreeEncoder(enc);
+	}
+	return crtc;
+}
+
+DrmPlane* DriDevice::findPlane(uint32_t planeId)
+{
+	for (auto& plane : planeList)
+	{
+		if (plane.mDrmPlane->plane_id == planeId)
+		{
+			return &plane;
+		}
+	}
+	return nullptr;
+}
+
+DrmCrtc* DriDevice::findCrtcById(uint32_t crtcId)
+{
+	for (auto& crtc : crtcList)
+	{
+		if (crtc.mCrtc->crtc_id == crtcId)
+		{
+			return &crtc;
+		}
+	}
+	return nullptr;
+}
+
+DrmConnector* DriDevice::findOutput(const std::string &output)
+{
+	if (output.empty())
+	{
+		return connectorList.empty() ? nullptr : &connectorList.front();
+	}
+	for (auto& conn : connectorList)
+	{
+		if (conn.getOutputName() == output)
+		{
+			return &conn;
+		}
+	}
+	return nullptr;
+}
+
+void DriDevice::buildPlanePools()
+{
+	//Only crtcs with a sink attached get planes, unless nothing is plugged in.
+	//Pools are fixed from here on, so planes handed out never change owner.
+	std::vector<DrmCrtc*> outputs;
+	std::vector<DrmCrtc*> unplugged;
+	for (auto& crtc : crtcList)
+	{
+		crtc.overlayPlanes.clear();
+		bool plugged = false;
+		for (auto connId : crtc.connectors)
+		{
+			auto conn = std::find_if(connectorList.begin(), connectorList.end(), [connId](DrmConnector &c)
+			{ return c.mConnectorPtr->connector_id == connId; });
+			plugged |= conn != connectorList.end() && conn->isConnected();
+		}
+		if (plugged)
+		{
+			outputs.push_back(&crtc);
+		}
+		else if (!crtc.connectors.empty())
+		{
+			unplugged.push_back(&crtc);
+		}
+	}
+	if (outputs.empty())
+	{
+		outputs.swap(unplugged);
+	}
+
+	//Planes usable by fewer crtcs are placed first, then each plane goes to the
+	//eligible crtc with the smallest pool. vc4 exposes its overlays on every crtc.
+	std::vector<std::pair<size_t, DrmPlane*>> overlays;
+	for (auto& plane : planeList)
+	{
+		plane.poolCrtcId = 0;
+		if (plane.type != DRM_PLANE_TYPE_OVERLAY)
+		{
+			continue;
+		}
+		size_t eligible = 0;
+		for (auto crtc : outputs)
+		{
+			if (plane.mDrmPlane->possible_crtcs & (1 << crtc->crtc_index))
+			{
+				eligible++;
+			}
+		}
+		if (eligible)
+		{
+			overlays.push_back(std::make_pair(eligible, &plane));
+		}
+	}
+	std::stable_sort(overlays.begin(), overlays.end(),
+	                 [](const std::pair<size_t, DrmPlane*> &a, const std::pair<size_t, DrmPlane*> &b)
+	{ return a.first < b.first; });
+
+	for (auto &entry : overlays)
+	{
+		DrmPlane *plane = entry.second;
+		DrmCrtc *pool = nullptr;
+		for (auto crtc : outputs)
+		{
+			if ((plane->mDrmPlane->possible_crtcs & (1 << crtc->crtc_index)) &&
+			    (!pool || crtc->overlayPlanes.size() < pool->overlayPlanes.size()))
+			{
+				pool = crtc;
+			}
+		}
+		pool->overlayPlanes.push_back(plane->mDrmPlane->plane_id);
+		plane->poolCrtcId = pool->mCrtc->crtc_id;
+	}
+	for (auto crtc : outputs)
+	{
+		//Keep the kernel's plane order within a pool
+		std::sort(crtc->overlayPlanes.begin(), crtc->overlayPlanes.end());
+		LOG_DEBUG("crtc %u: %zu overlay planes", crtc->mCrtc->crtc_id, crtc->overlayPlanes.size());
+	}
+}
+
+void DriDevice::loadProperties()
+{
+	properties.clear();
+	for (auto& crtc : crtcList)
+	{
+		properties.load(drmModuleFd, crtc.mCrtc->crtc_id, DRM_MODE_OBJECT_CRTC);
+	}
+	for (auto& conn : connectorList)
+	{
+		properties.load(drmModuleFd, conn.mConnectorPtr->connector_id, DRM_MODE_OBJECT_CONNECTOR);
+		conn.edidPropId = properties.id(conn.mConnectorPtr->connector_id, DRM_PROP_EDID);
+	}
+	for (auto& plane : planeList)
+	{
+		uint32_t planeId = plane.mDrmPlane->plane_id;
+		uint64_t value;
+		properties.load(drmModuleFd, planeId, DRM_MODE_OBJECT_PLANE);
+		if (properties.value(planeId, DRM_PROP_TYPE, value))
+		{
+			plane.type = static_cast<uint32_t>(value);
+		}
+		if (properties.value(planeId, DRM_PROP_ZPOS, value))
+		{
+			plane.state.zpos = static_cast<uint32_t>(value);
+		}
+		if (properties.value(planeId, DRM_PROP_ALPHA, value))
+		{
+			plane.state.alpha = static_cast<uint32_t>(value);
+		}
+		if (properties.value(planeId, DRM_PROP_ROTATION, value))
+		{
+			plane.state.rotation = static_cast<uint32_t>(value);
+		}
+		value = 0;
+		properties.value(planeId, DRM_PROP_IN_FORMATS, value);
+		plane.formats.load(drmModuleFd, plane.mDrmPlane, static_cast<uint32_t>(value));
+	}
+}
+
+void DriDevice::negotiateScanoutFormats()
+{
+	//Our fbs are drawn as 32 bit RGB, in any channel order the plane takes
+	static const std::vector<FormatOffer> offers = {
+		{DEFAULT_PIXEL_FORMAT, DRM_FORMAT_MOD_LINEAR},
+		{DRM_FORMAT_XBGR8888, DRM_FORMAT_MOD_LINEAR},
+		{DRM_FORMAT_ARGB8888, DRM_FORMAT_MOD_LINEAR},
+		{DRM_FORMAT_ABGR8888, DRM_FORMAT_MOD_LINEAR},
+	};
+	for (auto &crtc : crtcList)
+	{
+		DrmPlane *primary = crtc.primaryPlaneId ? findPlane(crtc.primaryPlaneId) : nullptr;
+		if (!primary)
+		{
+			continue; //legacy modeset, the kernel picks the primary plane
+		}
+		FormatChoice choice = negotiateFormat(offers, {{primary->mDrmPlane->plane_id, primary->type, &primary->formats}});
+		if (choice.path == FORMAT_PATH_DIRECT)
+		{
+			crtc.scanoutFormat = choice.format;
+		}
+		else
+		{
+			LOG_ERROR(MSGID_DEVICE_ERROR, 0, "Primary plane %u takes no 32 bit RGB, keeping %.4s",
+			          crtc.primaryPlaneId, reinterpret_cast<const char*>(&crtc.scanoutFormat));
+		}
+	}
+}
+
+bool DriDevice::probeConnectors(const std::set<uint32_t> &connectorIds, bool fullProbe,
+                                std::vector<DisplayChange> *changes)
+{
+	//Connection state, modes and the mode index only change on hotplug
+	bool changed = false;
+	if (fullProbe)
+	{
+		probeGeneration++;
+	}
+	for (auto& conn : connectorList)
+	{
+		uint32_t connId = conn.mConnectorPtr->connector_id;
+		if (!connectorIds.empty() && !connectorIds.count(connId))
+		{
+			continue;
+		}
+		uint64_t before = conn.stateSignature();
+		DisplayState state = changes ? conn.displayState() : DisplayState();
+		if (!conn.refresh(fullProbe))
+		{
+			//The sink is gone, its crtc has to be set up again on the next setActiveMode
+			for (auto& crtc : crtcList)
+			{
+				if (crtc.connectors.count(connId))
+				{
+					crtc.activeModeValid = false;
+				}
+			}
+		}
+		properties.load(drmModuleFd, connId, DRM_MODE_OBJECT_CONNECTOR);
+		if (fullProbe)
+		{
+			conn.updateEdidHash();
+		}
+		changed |= conn.stateSignature() != before;
+		if (changes)
+		{
+			size_t count = changes->size();
+			diffDisplayState(conn.getOutputName(), state, conn.displayState(), *changes);
+			changed |= changes->size() != count;
+		}
+	}
+	return changed;
+}
+
+int DriDevice::setActiveMode(DrmCrtc& crtc, const uint32_t width, const uint32_t height,const uint32_t vRefresh)
+{
+	ModesetRequest req;
+	int ret = prepareModeset(crtc, width, height, vRefresh, req);
+	if (ret)
+	{
+		return ret < 0 ? -1 : 0;
+	}
+	req.result = commitModeset(req);
+	return finishModeset(req);
+}
+
+int DriDevice::prepareModeset(DrmCrtc& crtc, uint32_t width, uint32_t height, uint32_t vRefresh, ModesetRequest &req)
+{
+	LOG_DEBUG("\n setActiveMode to %ux%u@%u", width, height, vRefresh);
+	//If there are no connectors dont set mode.
+	if (!crtc.connectors.size())
+	{
+		LOG_INFO (MSGID_DEVICE_STATUS, 0, "No connectors set for crtc %d", crtc.mCrtc->crtc_id);
+		return -1;
+	}
+	LOG_DEBUG("connectors has been set for crtc %d", crtc.mCrtc->crtc_id);
+
+	DrmDisplayMode mode;
+	//Check that all connectors connected to this crtc supports this mode.
+	//Currently there is only 1 connector.
+	for(auto connId: crtc.connectors)
+	{
+		auto conn = std::find_if(connectorList.begin(), connectorList.end(), [connId](DrmConnector &c)
+		{ return c.mConnectorPtr->connector_id == connId; });
+		if (!conn->isConnected())
+		{
+			LOG_DEBUG("ignoring unused connector %d", connId);
+			continue;
+		}
+
+		DrmDisplayMode connMode = conn->getMode(width, height, vRefresh);
+		if (!connMode.mModeInfoPtr)
+		{
+			LOG_ERROR(MSGID_INVALID_DISPLAY_MODE, 0, "Mode %ux%u@%u is not supported by %d", width, height, vRefresh, conn->mConnectorPtr->connector_id);
+			return -1;
+		}
+
+		if (!mode.mModeInfoPtr)
+			mode = connMode;
+	}
+
+	if (!mode.mModeInfoPtr)
+	{
+		LOG_ERROR(MSGID_DISPLAY_NOT_CONNECTED, 0, "cannot get a valid mode object or connector not connected for crtc %d", crtc.mCrtc->crtc_id);
+		return -1;
+	}
+
+	//create new front/back buffers if the current ones have a different size
+	if (crtc.createScanoutFb(*this, width, height, req.retired)) //create failed
+	{
+		return -1;
+	}
+
+	req.crtc = &crtc;
+	req.connIds.assign(crtc.connectors.begin(), crtc.connectors.end());
+	req.mode = *mode.mModeInfoPtr;
+	req.fbId = crtc.frontFbId();
+	req.submission = latency.submit(drmModuleFd, crtc.crtc_index, crtc.mCrtc->crtc_id, SCANOUT_OP_MODESET);
+
+	//Same timing already on the connectors, e.g. set by the firmware: at most put our fb on screen
+	bool ownFb = false;
+	if (isModeActive(crtc, req.connIds, req.mode, ownFb))
+	{
+		if (ownFb || !swapScanoutFb(crtc, req.mode))
+		{
+			LOG_DEBUG("crtc %d already drives %s, modeset skipped", crtc.mCrtc->crtc_id, req.mode.name);
+			crtc.activeMode = req.mode;
+			crtc.activeModeValid = true;
+			if (!ownFb)
+			{
+				latency.completeOnVblank(drmModuleFd, crtc.crtc_index, req.submission);
+			}
+			releaseRetiredFb(req); //the swap took the old pair off screen
+			return 1;
 		}
+		LOG_DEBUG("fb swap on crtc %d failed, doing a full modeset", crtc.mCrtc->crtc_id);
+	}
+
+	if (atomicSupported && buildAtomicModeset(req))
+	{
+		crtc.restoreScanoutFb(*this, req.retired);
+		return -1;
 	}
 	return 0;
 }
 
-uint32_t DriDevice::findCrtc(DrmConnector &conn)
+void DriDevice::releaseRetiredFb(ModesetRequest &req)
 {
-	drmModeEncoder *enc = nullptr;
-	int32_t crtc = 0;
-	/* try the currently conected encoder+crtc */
-	if (conn.mConnectorPtr->encoder_id)
+	for (auto &buf : req.retired)
 	{
-		enc = drmModeGetEncoder(drmModuleFd, conn.mConnectorPtr->encoder_id);
+		fbCache.release(drmModuleFd, buf);
 	}
-	if (enc)
-	{
-		if (enc->crtc_id)
-		{
-			crtc = enc->crtc_id;
+}
 
-		}
-		drmModeFreeEncoder(enc);
-		return crtc;
+int DriDevice::commitModeset(ModesetRequest &req) const
+{
+	if (req.atomicReq)
+	{
+		return req.atomicReq->commit(DRM_MODE_ATOMIC_ALLOW_MODESET);
 	}
+	if (drmModeSetCrtc(drmModuleFd, req.crtc->mCrtc->crtc_id, req.fbId, 0, 0,
+	                   req.connIds.data(), static_cast<int>(req.connIds.size()), &req.mode))
+	{
+		return -errno;
+	}
+	return 0;
+}
 
-	drmModeResPtr res = drmModeGetResources(drmModuleFd);
-
-	/* if connector does not have encoder+crtc connected*/
-	for (int i=0; i< conn.mConnectorPtr->count_encoders; i++)
+int DriDevice::finishModeset(ModesetRequest &req)
+{
+	DrmCrtc &crtc = *req.crtc;
+	if (req.result)
 	{
-		enc =  drmModeGetEncoder(drmModuleFd,  conn.mConnectorPtr->encoders[i]);
-		if (!enc)
+		LOG_ERROR(MSGID_DRM_MODESET_ERROR, 0, "Failed to set mode %d", req.result);
+		if (req.blobId)
 		{
-			LOG_DEBUG("encoder associated with connector not found");
-			continue;
+			drmModeDestroyPropertyBlob(drmModuleFd, req.blobId);
 		}
-		for (int j=0; j< res->count_crtcs; j++)
+		crtc.activeModeValid = false;
+		//The old pair is still on screen, the new one goes back to the cache
+		crtc.restoreScanoutFb(*this, req.retired);
+		return -1;
+	}
+
+	if (req.blobId)
+	{
+		if (crtc.modeBlobId)
 		{
-			if (!(enc->possible_crtcs & (1 << j)))
-			{
-				continue;
-			}
-			crtc = res->crtcs[j];
-			if (crtc >= 0) {
-				break;
-			}
+			drmModeDestroyPropertyBlob(drmModuleFd, crtc.modeBlobId);
 		}
-		drmModeFreeEncoder(enc);
+		crtc.modeBlobId = req.blobId;
 	}
-	return crtc;
+	crtc.activeMode = req.mode;
+	crtc.activeModeValid = true;
+	latency.completeOnVblank(drmModuleFd, crtc.crtc_index, req.submission);
+	releaseRetiredFb(req);
+	return 0;
 }
 
+//Compare the timings only, name, type and picture aspect flags differ between sources of the same mode
+static bool sameTiming(const drmModeModeInfo &a, const drmModeModeInfo &b)
+{
+	const uint32_t flagMask = ~DRM_MODE_FLAG_PIC_AR_MASK;
+	return a.clock == b.clock &&
+	       a.hdisplay == b.hdisplay && a.hsync_start == b.hsync_start &&
+	       a.hsync_end == b.hsync_end && a.htotal == b.htotal && a.hskew == b.hskew &&
+	       a.vdisplay == b.vdisplay && a.vsync_start == b.vsync_start &&
+	       a.vsync_end == b.vsync_end && a.vtotal == b.vtotal && a.vscan == b.vscan &&
+	       (a.flags & flagMask) == (b.flags & flagMask);
+}
 
-int DriDevice::setActiveMode(DrmCrtc& crtc, const uint32_t width, const uint32_t height,const uint32_t vRefresh)
+bool DriDevice::isModeActive(DrmCrtc &crtc, const std::vector<uint32_t> &connIds, const drmModeModeInfo &mode, bool &ownFb)
 {
-	std::stringstream modeStr;
-	modeStr << width << "x" <<height;
-	LOG_DEBUG("\n setActiveMode to %s", modeStr.str().c_str());
-	//If there are no connectors dont set mode.
-	if (!crtc.connectors.size())
+	//After our own modeset the cached mode is authoritative, no ioctl needed
+	if (crtc.activeModeValid)
 	{
-		LOG_INFO (MSGID_DEVICE_STATUS, 0, "No connectors set for crtc %d", crtc.mCrtc->crtc_id);
-		return -1;
+		ownFb = true;
+		return sameTiming(crtc.activeMode, mode);
 	}
-	LOG_DEBUG("connectors has been set for crtc %d", crtc.mCrtc->crtc_id);
 
-	DrmDisplayMode mode;
-	//Check that all connectors connected to this crtc supports this mode.
-	//Currently there is only 1 connector.
-	for(auto connId: crtc.connectors)
+	drmModeCrtcPtr current = drmModeGetCrtc(drmModuleFd, crtc.mCrtc->crtc_id);
+	if (!current)
+	{
+		return false;
+	}
+	bool active = current->mode_valid && current->buffer_id && sameTiming(current->mode, mode);
+	ownFb = current->buffer_id == crtc.scanout[0].fbId || current->buffer_id == crtc.scanout[1].fbId;
+	drmModeFreeCrtc(current);
+	if (!active)
+	{
+		return false;
+	}
+
+	//Every connector has to be routed to this crtc already
+	for (auto connId : connIds)
 	{
 		auto conn = std::find_if(connectorList.begin(), connectorList.end(), [connId](DrmConnector &c)
 		{ return c.mConnectorPtr->connector_id == connId; });
-		if (!conn->isPlugged())
+		if (conn == connectorList.end() || !conn->isConnected())
 		{
-			LOG_DEBUG("ignoring unused connector %d", connId);
 			continue;
 		}
-
-		if (!conn->isModeSupported(modeStr.str()))
+		drmModeEncoderPtr enc = conn->mConnectorPtr->encoder_id ?
+		                        drmModeGetEncoder(drmModuleFd, conn->mConnectorPtr->encoder_id) : nullptr;
+		bool routed = enc && enc->crtc_id == crtc.mCrtc->crtc_id;
+		if (enc)
 		{
-			LOG_ERROR(MSGID_INVALID_DISPLAY_MODE, 0, "Mode %s is not supported by %d", modeStr.str(), conn->mConnectorPtr->connector_id);
-			return -1;
+			drmModeFreeEncoder(enc);
+		}
+		if (!routed)
+		{
+			return false;
 		}
+	}
+	return true;
+}
 
-		if (!mode.mModeInfoPtr)
-			mode = conn->getMode(modeStr.str());
+int DriDevice::swapScanoutFb(DrmCrtc &crtc, const drmModeModeInfo &mode)
+{
+	if (crtc.flipPending)
+	{
+		return -EBUSY;
+	}
+	if (atomicSupported)
+	{
+		if (!crtc.primaryPlaneId)
+		{
+			return -EINVAL;
+		}
+		DrmPlaneState primary;
+		primary.planeId = crtc.primaryPlaneId;
+		primary.crtcId = crtc.mCrtc->crtc_id;
+		primary.fbId = crtc.frontFbId();
+		primary.crtc_w = primary.src_w = mode.hdisplay;
+		primary.crtc_h = primary.src_h = mode.vdisplay;
+		return commitPlane(primary);
+	}
+	//Same size fb on an unchanged mode, a flip needs no modeset
+	if (drmModePageFlip(drmModuleFd, crtc.mCrtc->crtc_id, crtc.frontFbId(), 0, nullptr))
+	{
+		return -errno;
 	}
+	return 0;
+}
 
-	if (!mode.mModeInfoPtr)
+int DriDevice::buildAtomicModeset(ModesetRequest &req)
+{
+	const uint32_t crtcId = req.crtc->mCrtc->crtc_id;
+	if (drmModeCreatePropertyBlob(drmModuleFd, &req.mode, sizeof(req.mode), &req.blobId))
 	{
-		LOG_ERROR(MSGID_DISPLAY_NOT_CONNECTED, 0, "cannot get a valid mode object or connector not connected for crtc %d", crtc.mCrtc->crtc_id);
+		LOG_ERROR(MSGID_DRM_MODESET_ERROR, 0, "Failed to create mode blob: %s", strerror(errno));
+		req.blobId = 0;
 		return -1;
 	}
 
-	//create a new Fb if current fb size is different
-	if (crtc.createScanoutFb(*this)) //create failed
+	//Connector routing, crtc mode, scanout fb and every overlay on this crtc go in one commit
+	req.atomicReq = std::make_shared<DrmAtomicRequest>(*this);
+	for (auto connId : req.connIds)
 	{
-		return -1;
+		req.atomicReq->addConnector(connId, crtcId);
 	}
+	req.atomicReq->addCrtc(crtcId, req.blobId, true);
 
-	uint32_t* conn_ids = (uint32_t*) calloc(crtc.connectors.size(), sizeof(uint32_t));
-	int index = 0;
-	for (auto connId: crtc.connectors)
+	if (req.crtc->primaryPlaneId)
 	{
-		conn_ids[index++]=connId;
+		DrmPlaneState primary;
+		primary.planeId = req.crtc->primaryPlaneId;
+		primary.crtcId = crtcId;
+		primary.fbId = req.fbId;
+		primary.crtc_w = primary.src_w = req.mode.hdisplay;
+		primary.crtc_h = primary.src_h = req.mode.vdisplay;
+		req.atomicReq->addPlane(primary);
 	}
-	int ret = drmModeSetCrtc(drmModuleFd, crtc.mCrtc->crtc_id, crtc.scanout_fbId, 0, 0,
-	                         conn_ids, 1, mode.mModeInfoPtr);
-	if (ret)
+	for (auto& plane : planeList)
+	{
+		if (plane.type == DRM_PLANE_TYPE_OVERLAY && plane.state.fbId && plane.state.crtcId == crtcId)
+		{
+			req.atomicReq->addPlane(plane.state);
+		}
+	}
+	return 0;
+}
+
+int DriDevice::commitPlane(const DrmPlaneState &state)
+{
+	return commitPlanes(std::vector<DrmPlaneState>(1, state), 0);
+}
+
+int DriDevice::commitPlanes(const std::vector<DrmPlaneState> &states, uint32_t atomicFlags, void *userData)
+{
+	if (atomicSupported)
+	{
+		DrmAtomicRequest req(*this);
+		for (auto &state : states)
+		{
+			req.addPlane(state);
+		}
+		int ret = req.commit(atomicFlags, userData);
+		if (ret)
+		{
+			return ret;
+		}
+		for (auto &state : states)
+		{
+			DrmPlane *plane = findPlane(state.planeId);
+			if (plane)
+			{
+				plane->state = state;
+			}
+		}
+		return 0;
+	}
+
+	//Legacy drivers need one ioctl per plane
+	for (auto &state : states)
 	{
-		LOG_ERROR(MSGID_DRM_MODESET_ERROR, 0, "Failed to set mode %d", ret);
+		DrmPlane *plane = findPlane(state.planeId);
+		if (drmModeSetPlane(drmModuleFd, state.planeId, state.crtcId, state.fbId, 0,
+		                    state.crtc_x, state.crtc_y, state.crtc_w, state.crtc_h,
+		                    state.src_x << 16, state.src_y << 16, state.src_w << 16, state.src_h << 16))
+		{
+			return -errno;
+		}
+		//zpos, alpha and rotation are separate properties, only set those that changed
+		const struct { DRM_PROP_T prop; uint32_t value; uint32_t committed; } optional[] = {
+			{DRM_PROP_ZPOS, state.zpos, plane ? plane->state.zpos : state.zpos},
+			{DRM_PROP_ALPHA, state.alpha, plane ? plane->state.alpha : state.alpha},
+			{DRM_PROP_ROTATION, state.rotation, plane ? plane->state.rotation : state.rotation},
+		};
+		for (auto &prop : optional)
+		{
+			uint32_t propId = properties.id(state.planeId, prop.prop);
+			if (propId && prop.value != prop.committed &&
+			    drmModeObjectSetProperty(drmModuleFd, state.planeId, DRM_MODE_OBJECT_PLANE, propId, prop.value))
+			{
+				return -errno;
+			}
+		}
+		if (plane)
+		{
+			plane->state = state;
+		}
 	}
 	return 0;
 }
@@ -369,108 +1482,302 @@ int DriDevice::hasDumbBuff()
 	return 0;
 }
 
-int DrmCrtc::createScanoutFb(DriDevice &device)
+int DrmCrtc::createScanoutFb(DriDevice &device, uint32_t width, uint32_t height, ScanoutBuffer retired[2])
 {
+	if (scanout[0].fbId && scanout[1].fbId && scanout[0].width == width && scanout[0].height == height)
+	{
+		return 0;
+	}
+
+	ScanoutBuffer next[2];
+	for (auto &buf : next)
+	{
+		int ret = device.fbCache.acquire(device.drmModuleFd, width, height, scanoutFormat, buf);
+		if (ret)
+		{
+			for (auto &acquired : next)
+			{
+				device.fbCache.release(device.drmModuleFd, acquired);
+			}
+			return ret;
+		}
+	}
 
-	uint32_t handles[4] = {0}, pitches[4] = {0}, offsets[4] = {0};
-	unsigned int fb_id;
+	//The old pair is still on screen until the modeset commits, the cache must
+	//not see it before then. Front first, so restoreScanoutFb keeps it in front.
+	retired[0] = scanout[front];
+	retired[1] = scanout[front ^ 1];
+	scanout[0] = next[0];
+	scanout[1] = next[1];
+	front = 0;
+	//A flip event still in flight refers to the old pair, drop it
+	flipPending = false;
+	flipSubmission = ScanoutSubmission();
+	return 0;
+}
 
-	int ret;
-	if (boHandle && scanout_fbId != 0)
+void DrmCrtc::restoreScanoutFb(DriDevice &device, ScanoutBuffer retired[2])
+{
+	if (!retired[0].fbId && !retired[1].fbId)
 	{
-		drmModeRmFB(device.drmModuleFd, scanout_fbId);
-		bo_destroy(boHandle);
+		return;
 	}
+	releaseScanoutFb(device);
+	scanout[0] = retired[0];
+	scanout[1] = retired[1];
+	front = 0;
+	retired[0] = ScanoutBuffer();
+	retired[1] = ScanoutBuffer();
+}
 
-	struct bo* bo = bo_create(device.drmModuleFd, DEFAULT_PIXEL_FORMAT, device.width,
-	                          device.height, handles, pitches, offsets);
-	if (!bo)
+void DrmCrtc::releaseScanoutFb(DriDevice &device)
+{
+	for (auto &buf : scanout)
 	{
-		LOG_ERROR(MSGID_BUFFER_CREATION_FAILED, 0,"failed to create frame buffers  (%ux%u): (%d)", device.width, device.height, strerror(errno));
-		return -errno;
+		device.fbCache.release(device.drmModuleFd, buf);
 	}
+	//A flip event still in flight refers to buffers that are gone, drop it
+	flipPending = false;
+	flipSubmission = ScanoutSubmission();
+}
 
-	//TODO:: set fourcc DRM_FORMAT_XRGB8888 as a config param
-	ret = drmModeAddFB2(device.drmModuleFd, device.width, device.height,
-	                    DRM_FORMAT_XRGB8888 , handles, pitches, offsets, &fb_id, 0);
-	if (ret) {
-		LOG_ERROR(MSGID_FB_CREATION_FAILED, 0, "failed to add fb (%ux%u): %s\n", device.width, device.height, strerror(errno));
-		bo_destroy(bo);
+int DrmCrtc::pageFlip(DriDevice &device)
+{
+	if (flipPending)
+	{
+		return -EBUSY;
+	}
+	const ScanoutBuffer &back = scanout[front ^ 1];
+	if (!back.fbId)
+	{
+		return -EINVAL;
+	}
+	flipSubmission = device.latency.submit(device.drmModuleFd, crtc_index, mCrtc->crtc_id, SCANOUT_OP_PAGE_FLIP);
+	if (drmModePageFlip(device.drmModuleFd, mCrtc->crtc_id, back.fbId, DRM_MODE_PAGE_FLIP_EVENT, this))
+	{
+		int ret = -errno;
+		LOG_ERROR(MSGID_DRM_MODESET_ERROR, 0, "Page flip on crtc %d failed: %s", mCrtc->crtc_id, strerror(errno));
+		flipSubmission = ScanoutSubmission();
 		return ret;
 	}
-
-	scanout_fbId = fb_id;
-	boHandle = bo;
+	flipPending = true;
 	return 0;
 }
 
+bool DrmCrtc::hasActiveMode(uint32_t width, uint32_t height, uint32_t vRefresh) const
+{
+	return activeModeValid && activeMode.hdisplay == width && activeMode.vdisplay == height &&
+	       !(activeMode.flags & DRM_MODE_FLAG_INTERLACE) &&
+	       (vRefresh == 0 || activeMode.vrefresh == vRefresh);
+}
+
+void DrmCrtc::onPageFlip(unsigned int sequence, unsigned int tvSec, unsigned int tvUsec)
+{
+	if (!flipPending)
+	{
+		return;
+	}
+	flipPending = false;
+	front ^= 1;
+	flipSubmission.complete(sequence, tvSec, tvUsec);
+	if (flipDone)
+	{
+		flipDone(*this);
+	}
+}
+
 DriDevice::~DriDevice()
 {
-	if (drmModuleFd)
+	if (drmModuleFd < 0)
 	{
-		//close(drmModuleFd);
+		return;
 	}
+	for (auto &crtc : crtcList)
+	{
+		crtc.releaseScanoutFb(*this);
+	}
+	fbCache.clear(drmModuleFd);
+	prime.clear(drmModuleFd);
+	DumbBufferPool::instance().clear(drmModuleFd); //the fd number may be reused by the next card
+	close(drmModuleFd);
+	//crtcs, encoders, planes and connector snapshots are released with their owners
 }
 
 DRIElements::~DRIElements()
 {
-	g_source_remove(mTimeOutHandle);
+	mOutputModesets.clear(); //waits for modesets still in flight
+	mModesetWorker.reset();
+	for (auto source : mDrmEventSources)
+	{
+		g_source_remove(source);
+	}
+	if (mUdevSource)
+	{
+		g_source_remove(mUdevSource);
+	}
+	if (mHotplugSource)
+	{
+		g_source_remove(mHotplugSource);
+	}
+	if (mPressureSource)
+	{
+		g_source_remove(mPressureSource);
+	}
+	if (mPressureFd >= 0)
+	{
+		close(mPressureFd);
+	}
 	delete mUDev;
 }
 
-std::vector<uint32_t> DRIElements::getPlanes()
+std::vector<uint32_t> DRIElements::getPlanes(const std::string &output)
 {
-	DriDevice &driDevice = mDeviceList[mPrimaryDev];
-	auto conn = driDevice.connectorList.begin();
-	auto crtc = std::find_if(driDevice.crtcList.begin(), driDevice.crtcList.end(), [conn](DrmCrtc &c)
-															{ return c.mCrtc->crtc_id == conn->crtc_id; });
-	std::vector<uint32_t> planes;
-	for (auto p : driDevice.planeList)
-	{
-		if (p.mDrmPlane->possible_crtcs  & (1 << crtc->crtc_index))
-		{
-			planes.push_back(p.mDrmPlane->plane_id);
-		}
-	}
-	return planes;
+	//Primary and cursor planes are only listed when atomic is enabled, they are not for video
+	DrmCrtc *crtc = outputCrtc(mDeviceList[mPrimaryDev], output);
+	return crtc ? crtc->overlayPlanes : std::vector<uint32_t>();
 }
 
 bool DRIElements::setPlane(uint planeId, uint fbId, uint32_t crtc_x, uint32_t  crtc_y, uint32_t  crtc_w, uint32_t  crtc_h,
-							  uint32_t src_x, uint32_t src_y, uint32_t src_w, uint32_t src_h)
+							  uint32_t src_x, uint32_t src_y, uint32_t src_w, uint32_t src_h, uint32_t format)
 {
 	LOG_DEBUG("Applying set plane to output {x:%u, y:%u, w:%u, h:%u} for source {x:%u, y:%u, w:%u, h:%u}, planeId %u",
 	          crtc_x, crtc_y, crtc_w, crtc_h, src_x, src_y, src_w, src_h, planeId);
 
 	DriDevice &driDevice = mDeviceList[mPrimaryDev];
-	auto conn = driDevice.connectorList.begin();
-
-	auto crtc = std::find_if(driDevice.crtcList.begin(), driDevice.crtcList.end(), [conn](DrmCrtc &c)
-	{ return c.mCrtc->crtc_id == conn->crtc_id; });
+	//A plane is shown on the output whose pool it belongs to
+	DrmPlane *plane = driDevice.findPlane(planeId);
+	DrmCrtc *crtc = plane ? driDevice.findCrtcById(plane->poolCrtcId) : nullptr;
+	if (!crtc)
+	{
+		LOG_ERROR(MSGID_DRM_SET_PLANE_FAILED, 0, "Plane %u is not in the pool of any output", planeId);
+		return false;
+	}
 
-	if (drmModeSetPlane(driDevice.drmModuleFd, planeId, crtc->mCrtc->crtc_id, fbId, 0,
-                        crtc_x, crtc_y, crtc_w, crtc_h, src_x, src_y, src_w<<16, src_h<<16))
+	if (format && !plane->formats.hasFormat(format))
 	{
-		LOG_ERROR(MSGID_DRM_SET_PLANE_FAILED, 0, "%s", strerror(errno));
+		LOG_ERROR(MSGID_DRM_SET_PLANE_FAILED, 0, "Plane %u cannot scan out %.4s", planeId,
+		          reinterpret_cast<const char*>(&format));
 		return false;
 	}
 
+	//Stacking, alpha and rotation stay as they are
+	DrmPlaneState state = getPlaneState(*plane);
+	state.crtcId = crtc->mCrtc->crtc_id;
+	state.fbId = fbId;
+	state.format = format;
+	state.crtc_x = crtc_x;
+	state.crtc_y = crtc_y;
+	state.crtc_w = crtc_w;
+	state.crtc_h = crtc_h;
+	state.src_x = src_x;
+	state.src_y = src_y;
+	state.src_w = src_w;
+	state.src_h = src_h;
+
+	//Batched with the other window updates of this crtc into the next vblank commit
+	mCoalescer->queue(state);
 	return true;
 }
 
-std::vector<AVAL_VIDEO_SIZE_T> DRIElements::getSupportedModes()
+void DRIElements::flushPlaneUpdates()
+{
+	if (mCoalescer)
+	{
+		mCoalescer->flushAll();
+	}
+}
+
+FormatChoice DRIElements::negotiateFormat(const std::vector<FormatOffer> &offers, const std::vector<uint32_t> &planeIds)
 {
 	DriDevice &driDevice = mDeviceList[mPrimaryDev];
-	auto conn = driDevice.connectorList.begin();
-	//Get unique wxh values.
-	if (conn !=  driDevice.connectorList.end())
+	std::vector<FormatCandidate> candidates;
+	for (uint32_t planeId : planeIds)
+	{
+		DrmPlane *plane = driDevice.findPlane(planeId);
+		if (plane)
+		{
+			candidates.push_back({planeId, plane->type, &plane->formats});
+		}
+	}
+
+	FormatChoice choice = ::negotiateFormat(offers, candidates);
+	switch (choice.path)
+	{
+		case FORMAT_PATH_DIRECT:
+			LOG_DEBUG("Plane %u scans out %.4s directly", choice.planeId,
+			          reinterpret_cast<const char*>(&choice.format));
+			break;
+		case FORMAT_PATH_CONVERT:
+			LOG_INFO(MSGID_DEVICE_STATUS, 0, "No plane scans out any offered format, %.4s needs a conversion to %.4s on plane %u",
+			         reinterpret_cast<const char*>(&offers[choice.offer].format),
+			         reinterpret_cast<const char*>(&choice.format), choice.planeId);
+			break;
+		default:
+			LOG_ERROR(MSGID_DRM_SET_PLANE_FAILED, 0, "None of %zu offered formats can be shown on %zu planes",
+			          offers.size(), candidates.size());
+			break;
+	}
+	return choice;
+}
+
+bool DRIElements::planeSupportsFormat(uint32_t planeId, uint32_t format, uint64_t modifier)
+{
+	DrmPlane *plane = mDeviceList[mPrimaryDev].findPlane(planeId);
+	return plane && plane->formats.supports(format, modifier);
+}
+
+std::vector<DrmPlaneState> DRIElements::getLayout()
+{
+	DriDevice &driDevice = mDeviceList[mPrimaryDev];
+	std::vector<DrmPlaneState> layout;
+	//Windows of every output, a layout is tested as a whole
+	for (auto &plane : driDevice.planeList)
+	{
+		if (plane.poolCrtcId)
+		{
+			layout.push_back(getPlaneState(plane));
+		}
+	}
+	return layout;
+}
+
+bool DRIElements::validateLayout(const std::vector<DrmPlaneState> &layout)
+{
+	bool valid = true;
+	if (mLayoutCache.lookup(layout, valid))
+	{
+		return valid;
+	}
+
+	DriDevice &driDevice = mDeviceList[mPrimaryDev];
+	if (!driDevice.atomicSupported)
 	{
-		auto modes = conn->getSupportedModes();
+		//Nothing to test against, the real ioctl will tell.
+		return true;
+	}
 
-		modes.erase(std::unique(modes.begin(), modes.end(),
-		            [] (const AVAL_VIDEO_SIZE_T& lhs, const AVAL_VIDEO_SIZE_T& rhs) {
-			            return (lhs.w == rhs.w && lhs.h == rhs.h);}),modes.end());
+	DrmAtomicRequest req(driDevice);
+	for (auto &state : layout)
+	{
+		if (state.fbId)
+		{
+			req.addPlane(state);
+		}
+	}
+	valid = (req.commit(DRM_MODE_ATOMIC_TEST_ONLY) == 0);
+	mLayoutCache.insert(layout, valid);
+	LOG_DEBUG("Layout of %zu planes validated: %s (cache %zu entries)", layout.size(),
+	          valid ? "valid" : "invalid", mLayoutCache.size());
+	return valid;
+}
 
-		return modes;
+std::vector<AVAL_VIDEO_SIZE_T> DRIElements::getSupportedModes(const std::string &output)
+{
+	DrmConnector *conn = mDeviceList[mPrimaryDev].findOutput(output);
+	//Get unique wxh values.
+	if (conn)
+	{
+		return conn->getSupportedModes();
 	}
 	return std::vector<AVAL_VIDEO_SIZE_T>();
 }
@@ -481,13 +1788,106 @@ bool DRIElements::setPlaneProperties( PLANE_PROPS_T propType, uint planeId, uint
 	DriDevice &driDevice = mDeviceList[mPrimaryDev];
 	LOG_DEBUG("property type=%d, plane id = %d, value = %+" PRId64, propType, planeId, value);
 
-	if (drmModeObjectSetProperty(driDevice.drmModuleFd, planeId, DRM_MODE_OBJECT_PLANE, propType, (uint64_t)value))
+	DrmPlane *plane = driDevice.findPlane(planeId);
+	if (!plane)
+	{
+		LOG_ERROR(MSGID_DRM_SET_PROP_FAILED, 0, "Unknown plane %u", planeId);
+		return false;
+	}
+
+	//Every property is part of the plane state, applied with the next vblank flush
+	DrmPlaneState state = getPlaneState(*plane);
+	DRM_PROP_T prop = DRM_PROP_FB_ID;
+	switch (propType)
+	{
+		case SET_PLANE_FB_T:
+			state.fbId = static_cast<uint32_t>(value);
+			break;
+		case SET_Z_ORDER_T:
+			prop = DRM_PROP_ZPOS;
+			state.zpos = static_cast<uint32_t>(value);
+			break;
+		case SET_ALPHA_T:
+			prop = DRM_PROP_ALPHA;
+			state.alpha = static_cast<uint32_t>(value);
+			break;
+		case SET_ROTATION_T:
+			prop = DRM_PROP_ROTATION;
+			state.rotation = static_cast<uint32_t>(value);
+			break;
+		default:
+			LOG_ERROR(MSGID_DRM_SET_PROP_FAILED, 0, "Unsupported plane property %d", propType);
+			return false;
+	}
+	//FB_ID is only listed for atomic clients, every plane has an fb
+	if (prop != DRM_PROP_FB_ID && !driDevice.properties.has(planeId, prop))
+	{
+		LOG_ERROR(MSGID_DRM_SET_PROP_FAILED, 0, "Plane %u has no %s property", planeId, DrmPropertyRegistry::name(prop));
+		return false;
+	}
+	mCoalescer->queue(state);
+	return true;
+}
+
+bool DRIElements::setPlaneGeometry(uint32_t planeId, int32_t crtc_x, int32_t crtc_y, uint32_t crtc_w, uint32_t crtc_h,
+                                   uint32_t src_x, uint32_t src_y, uint32_t src_w, uint32_t src_h)
+{
+	DriDevice &driDevice = mDeviceList[mPrimaryDev];
+	DrmPlane *plane = driDevice.findPlane(planeId);
+	if (!plane)
 	{
-		LOG_ERROR(MSGID_DRM_SET_PROP_FAILED, 0, "%s", strerror(errno));
+		LOG_ERROR(MSGID_DRM_SET_PLANE_FAILED, 0, "Unknown plane %u", planeId);
 		return false;
 	}
+
+	DrmPlaneState state = getPlaneState(*plane);
+	state.crtc_x = crtc_x;
+	state.crtc_y = crtc_y;
+	state.crtc_w = crtc_w;
+	state.crtc_h = crtc_h;
+	state.src_x = src_x;
+	state.src_y = src_y;
+	state.src_w = src_w;
+	state.src_h = src_h;
+
+	if (!state.crtcId)
+	{
+		state.crtcId = plane->poolCrtcId;
+	}
+
+	//Without an fb the geometry is only kept and applied together with the next fb
+	mCoalescer->queue(state);
 	return true;
+}
+
+DrmPlaneState DRIElements::getPlaneState(const DrmPlane &plane)
+{
+	DrmPlaneState state;
+	if (!mCoalescer || !mCoalescer->pending(plane.mDrmPlane->plane_id, state))
+	{
+		state = plane.state;
+	}
+	state.planeId = plane.mDrmPlane->plane_id;
+	//The fb may have been attached by the media pipeline itself, which bypasses the tracked state
+	if (!state.fbId)
+	{
+		drmModePlanePtr current = drmModeGetPlane(mDeviceList[mPrimaryDev].drmModuleFd, state.planeId);
+		if (current)
+		{
+			state.fbId = current->fb_id;
+			if (current->fb_id)
+			{
+				state.crtcId = current->crtc_id;
+			}
+			drmModeFreePlane(current);
+		}
+	}
+	return state;
+}
 
+PlaneUpdateStats DRIElements::getPlaneUpdateStats()
+{
+	return mCoalescer ? mCoalescer->stats() : PlaneUpdateStats();
 }
 
 uint32_t DRIElements::getPlaneBase()
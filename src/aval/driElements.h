@@ -27,15 +27,31 @@
 #include <unordered_map>
 #include <glib.h>
 #include <set>
+#include <map>
 #include <aval/aval_video.h>
 #include <functional>
+#include <atomic>
+#include <memory>
 #include "buffers.h"
+#include "displayChange.h"
+#include "drmEvents.h"
+#include "drmResources.h"
 #include "edid.h"
+#include "edidCache.h"
+#include "formatNegotiation.h"
+#include "layoutCache.h"
+#include "primeImport.h"
+#include "propertyRegistry.h"
+#include "scanoutFbCache.h"
+#include "scanoutLatency.h"
 #include "logging.h"
 
 #define DEFAULT_PIXEL_FORMAT DRM_FORMAT_XRGB8888
 class DRIElements;
 class DriDevice;
+class PlaneUpdateCoalescer;
+class DrmAtomicRequest;
+class ModesetWorker;
 class DrmDisplayMode{
 //TODO:: Remove this class and utils surrounding it
 public:
@@ -69,100 +85,213 @@ struct compare_AVAL_VIDEO_SIZE {
 struct DrmConnector
 {
 
+	//Takes ownership of pConnector. Each connector owns its latest snapshot,
+	//which a probe replaces, so connectors can be moved but not copied.
 	DrmConnector(int fd, drmModeConnectorPtr pConnector);
-	void copy(const DrmConnector &other)
-	{ mConnectorPtr = other.mConnectorPtr; mProps = other.mProps;
-		props_info = other.props_info; mDrmModulefd = other.mDrmModulefd;
-		mName = other.mName;
-		crtc_id = other.crtc_id;
-
-	};
-	DrmConnector(const DrmConnector &other)
-	{
-		copy(other);
-	}
-	DrmConnector& operator=(const DrmConnector &other)
-	{
-		copy(other); return *this;
-	}
+	DrmConnector(const DrmConnector &other) = delete;
+	DrmConnector& operator=(const DrmConnector &other) = delete;
+	DrmConnector(DrmConnector &&other) = default;
+	DrmConnector& operator=(DrmConnector &&other) = default;
 
 	DrmConnector(){};
 	~DrmConnector(){};
 
 	void setCrtcId(int id) {crtc_id = id;}
 
-	bool isModeSupported(std::string mode_name, const uint32_t vRefresh=0);
-	std::vector<AVAL_VIDEO_SIZE_T>  getSupportedModes();
-	bool getModeRange(DrmDisplayMode& min, DrmDisplayMode& max);
-	DrmDisplayMode getMode(const std::string mode_name, const uint32_t vRefresh=0);
-	Edid getEdid();
+	//Every query is answered from the mode table built on probe: modes sorted largest
+	//first, then by refresh, without duplicates. vRefresh 0 matches the preferred
+	//mode if it has that size, else the highest refresh rate of the size.
+	bool isModeSupported(uint32_t width, uint32_t height, uint32_t vRefresh=0, bool interlace=false) const;
+	DrmDisplayMode getMode(uint32_t width, uint32_t height, uint32_t vRefresh=0, bool interlace=false) const;
+	//Progressive sizes, largest first
+	const std::vector<AVAL_VIDEO_SIZE_T>& getSupportedModes() const { return mSupportedSizes; }
+	//Refresh rates of a size, highest first, empty if the size is not supported
+	const std::vector<uint32_t>& getRefreshRates(uint32_t width, uint32_t height, bool interlace=false) const;
+	//Smallest and largest progressive modes, false if not connected
+	bool getModeRange(DrmDisplayMode& min, DrmDisplayMode& max) const;
+	bool getSizeRange(AVAL_VIDEO_SIZE_T& min, AVAL_VIDEO_SIZE_T& max) const;
+	DrmDisplayMode getPreferredMode(); //null mode if the sink marked none
+	Edid getEdid(); //empty if the sink has none or it is gone
+	//Modes and preferred mode as last read from the kernel or the EDID cache
+	EdidModeTable getModeTable() const;
+	//Serve a mode table from the EDID cache until the next probe replaces it
+	void useCachedModes(const EdidModeTable &table);
+	bool hasCachedModes() const { return mModesFromCache; }
 	std::string getName(){
 		return mName;
 	}
-
-	bool isPlugged();
+	//Connector type and index, e.g. "HDMI-A-1", addresses an output through DRIElements
+	const std::string& getOutputName() const { return mOutputName; }
+
+	bool isPlugged(); //full probe, only on hotplug
+	bool refresh(bool probe); //probe or re-read the kernel's current state, returns isConnected
+	void adopt(drmModeConnectorPtr fresh); //take over a connector read elsewhere, e.g. on a worker
+	bool isConnected() const; //state as of the last probe
+	//Hash of connection status and mode timings as of the last probe
+	uint64_t stateSignature() const { return mStateSignature; }
+	//Connection, sizes, preferred mode and EDID hash as of the last probe
+	DisplayState displayState() const;
+	void updateEdidHash(); //re-read the EDID blob, after a full probe
 	//void readProperties();
 
 	int mDrmModulefd = -1; //is this needed
 	uint32_t crtc_id = 0; //connected to crtc
+	uint32_t edidPropId = 0; //from the device property registry
 	std::string mName;
-	drmModeConnector *mConnectorPtr = nullptr;
-	drmModeObjectProperties *mProps = nullptr;
-	drmModePropertyRes **props_info;
+	std::string mOutputName;
+	DrmObjectPtr<drmModeConnector> mConnectorPtr;
+
+	//drmModeGetConnector / drmModeGetConnectorCurrent calls made through refresh
+	static std::atomic<uint64_t> sFullProbes;
+	static std::atomic<uint64_t> sCurrentReads;
+
+private:
+	static uint64_t modeKey(uint32_t width, uint32_t height, uint32_t vRefresh, bool interlace)
+	{
+		return (uint64_t(width & 0xffff) << 48) | (uint64_t(height & 0xffff) << 32) |
+		       (uint64_t(vRefresh & 0x7fffffff) << 1) | (interlace ? 1 : 0);
+	}
+	void buildModeTable();
+
+	std::vector<drmModeModeInfo> mModes; //sorted kernel modes, or the cached ones until verified
+	int mPreferredMode = -1; //index into mModes
+	int mMinMode = -1;
+	int mMaxMode = -1;
+	bool mModesFromCache = false;
+	std::unordered_map<uint64_t, int> mModeIndex; //modeKey -> index into mModes
+	std::vector<AVAL_VIDEO_SIZE_T> mSupportedSizes; //unique progressive sizes in table order
+	std::unordered_map<uint64_t, std::vector<uint32_t>> mRefreshRates; //modeKey without refresh -> rates
+	uint64_t mStateSignature = 0;
+	uint64_t mEdidHash = 0;
 
 	friend DRIElements;
 	friend DriDevice;
 };
 
+//Crtcs, encoders and planes point into the DrmResourceArena of their device
 class DrmEncoder
 {
 	drmModeEncoder *mEncoder = nullptr;
 public:
 	DrmEncoder(drmModeEncoder *encoder):mEncoder(encoder){};
+	DrmEncoder(const DrmEncoder&) = delete;
+	DrmEncoder& operator=(const DrmEncoder&) = delete;
+	DrmEncoder(DrmEncoder&&) = default;
+	DrmEncoder& operator=(DrmEncoder&&) = default;
 };
 
-struct DrmCrtc
+struct DrmCrtc : public DrmEventListener
 {
 
 	DrmCrtc(drmModeCrtc *crtc, uint32_t index):mCrtc(crtc),crtc_index(index){};
 
-	void copy(const DrmCrtc &other)
-	{
-		mCrtc = other.mCrtc;
-		boHandle = other.boHandle;
-		scanout_fbId = other.scanout_fbId;
-		connectors = other.connectors;
-		crtc_index = other.crtc_index;
-	}
-
-	DrmCrtc(const DrmCrtc &crtc)
-	{ copy(crtc);
-	};
-
-	DrmCrtc& operator=(const DrmCrtc &crtc)
-	{ copy(crtc); return *this;};
-
-	int createScanoutFb(DriDevice &device);
+	//The scanout buffers belong to exactly one crtc. A crtc is registered as
+	//page flip listener by address, so it must not move once enumeration is done.
+	DrmCrtc(const DrmCrtc &crtc) = delete;
+	DrmCrtc& operator=(const DrmCrtc &crtc) = delete;
+	DrmCrtc(DrmCrtc &&crtc) = default;
+	DrmCrtc& operator=(DrmCrtc &&crtc) = default;
+
+	//Install a pair of this size. The old pair may still be on screen, it is moved
+	//to retired and only given back once the modeset using the new pair commits.
+	int createScanoutFb(DriDevice &device, uint32_t width, uint32_t height, ScanoutBuffer retired[2]);
+	//Give the new pair back and reinstate retired, after a failed modeset
+	void restoreScanoutFb(DriDevice &device, ScanoutBuffer retired[2]);
+	void releaseScanoutFb(DriDevice &device);
+
+	//Buffer currently scanned out, and the one free for drawing the next frame.
+	//No buffer is free while a flip is pending.
+	uint32_t frontFbId() const { return scanout[front].fbId; }
+	struct bo* frontBuffer() const { return scanout[front].bo; }
+	struct bo* backBuffer() const { return flipPending ? nullptr : scanout[front ^ 1].bo; }
+
+	//Queue the back buffer for scanout at the next vblank. Completion arrives through
+	//onPageFlip from the DRM fd source, which swaps front and back and calls flipDone.
+	int pageFlip(DriDevice &device);
+	void onPageFlip(unsigned int sequence, unsigned int tvSec, unsigned int tvUsec) override;
+
+	//True when the mode set by the last setActiveMode has this size (and refresh, if not 0)
+	bool hasActiveMode(uint32_t width, uint32_t height, uint32_t vRefresh = 0) const;
 
 	drmModeCrtc *mCrtc = nullptr;
 	std::set<uint32_t> connectors;
-	uint32_t scanout_fbId=0;
+	ScanoutBuffer scanout[2];
+	uint32_t front = 0;
+	bool flipPending = false;
+	std::function<void(DrmCrtc&)> flipDone;
+	ScanoutSubmission flipSubmission; //latency stamp of the pending flip
 	uint32_t crtc_index =0;
-	struct bo *boHandle = nullptr;
+	uint32_t primaryPlaneId = 0; //only known when atomic/universal planes are enabled
+	uint32_t scanoutFormat = DEFAULT_PIXEL_FORMAT; //of our own fbs, negotiated with the primary plane
+	std::vector<uint32_t> overlayPlanes; //plane pool of this crtc, see DriDevice::buildPlanePools
+	uint32_t modeBlobId = 0; //MODE_ID blob of the active mode (atomic only)
+	drmModeModeInfo activeMode{}; //mode scanned out with our buffers, valid after setActiveMode
+	bool activeModeValid = false;
 
 	friend DRIElements;
 };
 
+//Complete state of a plane as applied by a single atomic commit or drmModeSetPlane.
+//Source rectangle is in whole pixels, it is converted to 16.16 when committed.
+struct DrmPlaneState {
+	uint32_t planeId = 0;
+	uint32_t crtcId = 0;
+	uint32_t fbId = 0;
+	uint32_t format = 0; //fourcc of fbId, 0 if not known
+	uint32_t zpos = 0;
+	uint32_t alpha = 0xffff; //opaque, only applied if the plane has an alpha property
+	uint32_t rotation = DRM_MODE_ROTATE_0; //only applied if the plane has a rotation property
+	int32_t crtc_x = 0;
+	int32_t crtc_y = 0;
+	uint32_t crtc_w = 0;
+	uint32_t crtc_h = 0;
+	uint32_t src_x = 0;
+	uint32_t src_y = 0;
+	uint32_t src_w = 0;
+	uint32_t src_h = 0;
+};
+
+//Counters of the vblank aligned plane update coalescer
+struct PlaneUpdateStats {
+	uint64_t updates = 0;   //plane updates queued
+	uint64_t merged = 0;    //updates that replaced a queued one
+	uint64_t commits = 0;   //commits issued by flushes
+	uint64_t failed = 0;    //commits rejected by the kernel
+	uint64_t deferred = 0;  //flushes postponed because the previous commit was busy
+};
+
 struct DrmPlane {
 	drmModePlane *mDrmPlane;
+	uint32_t type = DRM_PLANE_TYPE_OVERLAY;
+	uint32_t poolCrtcId = 0; //crtc whose pool holds this overlay plane, 0 if none
+	PlaneFormatSet formats; //IN_FORMATS, loaded with the plane properties
+	DrmPlaneState state; //last state successfully committed
 
 	DrmPlane(drmModePlane *drmPlane) : mDrmPlane(drmPlane) {}
+	DrmPlane(const DrmPlane&) = delete;
+	DrmPlane& operator=(const DrmPlane&) = delete;
+	DrmPlane(DrmPlane&&) = default;
+	DrmPlane& operator=(DrmPlane&&) = default;
 
 	friend std::ostream& operator<< (std::ostream &os, const DrmPlane &dm);
 
 };
 
 
+//Everything a modeset needs, resolved up front by DriDevice::prepareModeset
+struct ModesetRequest
+{
+	DrmCrtc *crtc = nullptr;
+	std::vector<uint32_t> connIds;
+	drmModeModeInfo mode{};
+	uint32_t fbId = 0;
+	uint32_t blobId = 0; //MODE_ID blob, atomic only
+	std::shared_ptr<DrmAtomicRequest> atomicReq; //null on legacy devices
+	ScanoutSubmission submission;
+	ScanoutBuffer retired[2]; //pair the mode was scanned out from, released by finishModeset
+	int result = 0; //of commitModeset
+};
+
 void dumpProperties ( std::ostream &os, drmModePropertyPtr prop,
                       uint32_t prop_id, uint64_t value);
 
@@ -170,6 +299,8 @@ class DriDevice
 {
 public :
 	std::string deviceName; //"/dev/dri/card0"
+	std::string driverName; //"vc4"
+	DrmResourceArena resources; //crtcs, encoders and planes of this enumeration
 	int drmModuleFd = -1;
 
 	std::vector<DrmConnector> connectorList;
@@ -182,26 +313,65 @@ public :
 	//uint32_t vRefresh = 0;
 	uint32_t stride=0;
 
+	bool atomicSupported = false; //DRM_CLIENT_CAP_ATOMIC accepted by the driver
+	DrmPropertyRegistry properties;
+	ScanoutLatencyTracker latency; //submit to scanout latency of every commit on this device
+	ScanoutFbCache fbCache; //scanout buffers of recently used modes
+	PrimeImporter prime; //fbs of dma-bufs from outside this library
+
 	uint32_t findCrtc(DrmConnector &conn);
+	DrmPlane* findPlane(uint32_t planeId);
+	DrmCrtc* findCrtcById(uint32_t crtcId);
+	//Connector by output name, the first connector for an empty name
+	DrmConnector* findOutput(const std::string &output);
+	//Split the overlay planes among the crtcs driving a connector, so windows
+	//of different outputs never compete for the same plane
+	void buildPlanePools();
+	//Pick a 32 bit RGB layout the primary plane of each crtc scans out for its fbs
+	void negotiateScanoutFormats();
 	int hasDumbBuff();
+	void loadProperties();
+	//Refresh the given connectors, all of them if connectorIds is empty, with a full
+	//probe or a current state read. Returns true if any changed connection state or modes.
+	//The changes of every refreshed connector are appended to changes if given.
+	bool probeConnectors(const std::set<uint32_t> &connectorIds = std::set<uint32_t>(), bool fullProbe = true,
+	                     std::vector<DisplayChange> *changes = nullptr);
+	uint32_t probeGeneration = 0; //bumped by every full probe through probeConnectors
 
 	int setupDevice();
 	int geModeRange(AVAL_VIDEO_SIZE_T &minSize, AVAL_VIDEO_SIZE_T &maxSize);
 
 	DriDevice(){}
+	DriDevice(const DriDevice&) = delete;
+	DriDevice& operator=(const DriDevice&) = delete;
 
 	~DriDevice();
 
 	int setActiveMode(DrmCrtc&, const uint32_t width, const uint32_t vRefreshheight, const uint32_t vRefresh=0);
+	//setActiveMode in three steps, so the blocking commit can run on the modeset worker.
+	//prepareModeset returns <0 on error, 1 if the mode is already active and 0 if
+	//commitModeset is needed. Only commitModeset may run off the main thread.
+	int prepareModeset(DrmCrtc &crtc, uint32_t width, uint32_t height, uint32_t vRefresh, ModesetRequest &req);
+	int commitModeset(ModesetRequest &req) const;
+	int finishModeset(ModesetRequest &req);
+	int buildAtomicModeset(ModesetRequest &req);
+	bool isModeActive(DrmCrtc &crtc, const std::vector<uint32_t> &connIds, const drmModeModeInfo &mode, bool &ownFb);
+	int swapScanoutFb(DrmCrtc &crtc, const drmModeModeInfo &mode);
+	void releaseRetiredFb(ModesetRequest &req); //once the new pair is on screen
+	int commitPlane(const DrmPlaneState &state);
+	int commitPlanes(const std::vector<DrmPlaneState> &states, uint32_t atomicFlags, void *userData = nullptr);
 
 	friend DRIElements;
 };
 
+//Plane properties settable through DRIElements::setPlaneProperties.
+//Resolved to the real kernel property ids through DriDevice::properties.
 typedef enum
 {
-	SET_PLANE_FB_T = 0xff01,
-	SET_Z_ORDER_T = 0xff02,
-	SET_SCALING_T = 0xff03
+	SET_PLANE_FB_T = 0,
+	SET_Z_ORDER_T,
+	SET_ALPHA_T,
+	SET_ROTATION_T
 } PLANE_PROPS_T;
 
 
@@ -210,23 +380,68 @@ class DRIElements
 {
 public:
 
+	//The listener is called on the main loop for every change of an output found
+	//on hotplug or by the boot verification, never for the state at startup.
 	DRIElements(AVAL_VIDEO_SIZE_T defResolution,
-	            std::function<void(AVAL_VIDEO_SIZE_T, AVAL_VIDEO_SIZE_T)>);
+	            std::function<void(const DisplayChange&)> listener);
 	virtual ~DRIElements();
 
 	std::string mPrimaryDev;
-	int changeMode(uint32_t width, uint32_t height, uint32_t vRefresh =0);
+	//Outputs of the primary device by name, e.g. "HDMI-A-1". Calls taking an
+	//output address its crtc, an empty name means the first connector.
+	std::vector<std::string> getOutputs();
+	int changeMode(uint32_t width, uint32_t height, uint32_t vRefresh =0, const std::string &output = std::string());
+	//Applies the mode on the modeset worker thread of the output's crtc and calls done
+	//on the main loop. Outputs are set independently, a slow link training on one does
+	//not delay another. A request made while one is in flight on the same output
+	//replaces any request still waiting there.
+	bool changeModeAsync(uint32_t width, uint32_t height, uint32_t vRefresh, std::function<void(bool)> done,
+	                     const std::string &output = std::string());
 	std::unordered_map<std::string, DriDevice> mDeviceList;
-	std::vector<uint32_t> getPlanes();
+	std::vector<uint32_t> getPlanes(const std::string &output = std::string()); //plane pool of the output
+	//Queued like every window update and committed on the next vblank of the plane's crtc
 	bool setPlane(unsigned int planeId, unsigned int fbId, uint32_t crtc_x, uint32_t  crtc_y, uint32_t  crtc_w, uint32_t  crtc_h,
-	              uint32_t src_x, uint32_t src_y, uint32_t src_w, uint32_t src_h);
-	std::vector<AVAL_VIDEO_SIZE_T> getSupportedModes();
+	              uint32_t src_x, uint32_t src_y, uint32_t src_w, uint32_t src_h, uint32_t format = 0);
+	//Commit queued plane updates now instead of at the next vblank, e.g. before freeing their fbs
+	void flushPlaneUpdates();
+	//Cheapest of the client's formats on one of these planes of the primary device, e.g.
+	//NV12 on a YUV overlay rather than an RGB conversion. A conversion is logged.
+	FormatChoice negotiateFormat(const std::vector<FormatOffer> &offers, const std::vector<uint32_t> &planeIds);
+	bool planeSupportsFormat(uint32_t planeId, uint32_t format, uint64_t modifier = DRM_FORMAT_MOD_LINEAR);
+	std::vector<DrmPlaneState> getLayout();
+	bool validateLayout(const std::vector<DrmPlaneState> &layout);
+	const PlaneLayoutCache& getLayoutCache() { return mLayoutCache; }
+	//Queued state if any, else committed. An fb attached outside DRIElements is looked up.
+	DrmPlaneState getPlaneState(const DrmPlane &plane);
+	PlaneUpdateStats getPlaneUpdateStats();
+	const ScanoutLatencyTracker& getScanoutLatency() { return mDeviceList[mPrimaryDev].latency; }
+	void setScanoutFbCacheBudget(size_t bytes);
+	//Bytes of freed dumb buffers kept for reuse by bo_create, 0 disables the pool
+	void setBufferPoolBudget(size_t bytes);
+	//Wrap a dma-buf, e.g. a V4L2 or CMA video frame, in an fb of the primary device
+	//that setPlane scans out without a copy. The fb is kept until releaseDmabuf.
+	bool importDmabuf(const DmabufFrame &frame, uint32_t &fbId);
+	void releaseDmabuf(uint32_t fbId);
+	//Hotplug events are applied once no new one arrived for this long
+	void setHotplugDebounce(uint32_t ms) { mHotplugDebounceMs = ms; }
+	std::vector<AVAL_VIDEO_SIZE_T> getSupportedModes(const std::string &output = std::string());
 	bool setPlaneProperties( PLANE_PROPS_T propType, uint planeId,uint64_t value);
+	bool setPlaneGeometry(uint32_t planeId, int32_t crtc_x, int32_t crtc_y, uint32_t crtc_w, uint32_t crtc_h,
+	                      uint32_t src_x, uint32_t src_y, uint32_t src_w, uint32_t src_h);
 
 	uint32_t getPlaneBase();
 
 private:
 
+	//A drm uevent. Connector hotplug events name the connector and, for
+	//property changes such as link-status, the property (0 when absent).
+	struct HotplugEvent
+	{
+		std::string node;
+		uint32_t connectorId;
+		uint32_t propertyId;
+	};
+
 	class UDev
 	{
 		struct udev* udev;
@@ -234,23 +449,82 @@ private:
 		struct udev_list_entry* devices;
 		struct udev_monitor* mon;
 		int fd;
-		std::function<void(std::string)> updateFun;
+		std::function<void(const HotplugEvent&)> updateFun;
 	public:
-		UDev(std::function<void(std::string)>);
-		static gboolean pollDRIDevices(gpointer userData);
+		UDev(std::function<void(const HotplugEvent&)>);
+		~UDev();
+		UDev(const UDev&) = delete;
+		UDev& operator=(const UDev&) = delete;
+		static gboolean onUdevEvent(gint fd, GIOCondition condition, gpointer userData);
+		int getFd() { return fd; }
 		std::vector<std::string> getDeviceList();
 	};
 
-	void setupDevicePolling();
-	void updateDevice(std::string name);
+	void setupDeviceMonitor();
+	void setupDrmEvents();
+	void setupMemoryPressure(); //drop idle pooled buffers when the system runs short of memory
+	void updateDevice(std::string name, const std::set<uint32_t> &connectorIds = std::set<uint32_t>(),
+	                  bool fullProbe = true, bool force = false);
+	void queueHotplug(const HotplugEvent &event);
+	static gboolean flushHotplug(gpointer userData);
 	void loadResources();
-
-
-	guint mTimeOutHandle;
+	bool loadCard(DriDevice &device); //thread safe for distinct devices
+	void updateModeRange(DriDevice &device); //device size from the configured mode and the first output
+	void notifyChanges(DriDevice &device, std::vector<DisplayChange> &changes);
+	//Boot: modes from the kernel's current state or the EDID cache, probe only if neither has any
+	void restoreModes(DriDevice &device, DrmConnector &conn);
+	void storeModes(DriDevice &device, DrmConnector &conn);
+	//Identifies an output across boots in the EDID cache, e.g. "vc4-HDMI-A-1"
+	static std::string edidCacheKey(DriDevice &device, DrmConnector &conn);
+	//Full probe of every connector on the modeset worker, applied on the main loop
+	void verifyModes(const std::string &name);
+	DrmCrtc* outputCrtc(DriDevice &device, const std::string &output);
+	void startModeChange(uint32_t crtcId, uint32_t width, uint32_t height, uint32_t vRefresh,
+	                     std::function<void(bool)> done);
+	void modeChanged(DriDevice &device, DrmCrtc &crtc, uint32_t width, uint32_t height);
+
+
+	guint mUdevSource = 0;
+
+	struct PendingHotplug
+	{
+		bool allConnectors = false;
+		bool propertyOnly = true; //every event was a property change, no probe needed
+		std::set<uint32_t> connectors;
+	};
+	std::map<std::string, PendingHotplug> mPendingHotplug; //by device node
+	guint mHotplugSource = 0;
+	gint64 mHotplugFirstEvent = 0;
+	uint32_t mHotplugDebounceMs = 100;
 	UDev *mUDev = nullptr;
 	friend DriDevice;
 
-	std::function<void(AVAL_VIDEO_SIZE_T, AVAL_VIDEO_SIZE_T)> mAvalCallBack;
+	PlaneLayoutCache mLayoutCache; //TEST_ONLY results, dropped on mode change and hotplug
+	std::unique_ptr<PlaneUpdateCoalescer> mCoalescer; //window updates of the primary device
+	std::vector<guint> mDrmEventSources;
+	int mPressureFd = -1;
+	guint mPressureSource = 0;
+
+	struct PendingModeChange
+	{
+		uint32_t width;
+		uint32_t height;
+		uint32_t vRefresh;
+		std::function<void(bool)> done;
+		bool valid;
+	};
+	//Modesets of one crtc run in order on its own worker, those of different crtcs in parallel
+	struct OutputModeset
+	{
+		std::unique_ptr<ModesetWorker> worker;
+		bool inFlight = false;
+		PendingModeChange next{0, 0, 0, nullptr, false};
+	};
+	std::unique_ptr<ModesetWorker> mModesetWorker; //EDID verification and other device jobs
+	std::map<uint32_t, OutputModeset> mOutputModesets; //by crtc id
+
+	std::function<void(const DisplayChange&)> mDisplayListener;
 	AVAL_VIDEO_SIZE_T mInitialMode; //Set from device_capability config file.
 	AVAL_VIDEO_SIZE_T mConfiguredMode; //Updated by changeMode or luna command.
+	EdidCache mEdidCache;
 };
@@ -0,0 +1,103 @@
+// Copyright (c) 2017-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <cerrno>
+#include <cstring>
+#include <xf86drm.h>
+#include "drmEvents.h"
+#include "logging.h"
+
+static void vblankHandler(int fd, unsigned int sequence, unsigned int tvSec, unsigned int tvUsec, void *userData)
+{
+	if (userData)
+	{
+		static_cast<DrmEventListener*>(userData)->onVblank(sequence, tvSec, tvUsec);
+	}
+}
+
+static void pageFlipHandler(int fd, unsigned int sequence, unsigned int tvSec, unsigned int tvUsec, void *userData)
+{
+	if (userData)
+	{
+		static_cast<DrmEventListener*>(userData)->onPageFlip(sequence, tvSec, tvUsec);
+	}
+}
+
+static unsigned int vblankCrtcType(uint32_t crtcIndex)
+{
+	if (crtcIndex == 1)
+	{
+		return DRM_VBLANK_SECONDARY;
+	}
+	if (crtcIndex > 1)
+	{
+		return (crtcIndex << DRM_VBLANK_HIGH_CRTC_SHIFT) & DRM_VBLANK_HIGH_CRTC_MASK;
+	}
+	return 0;
+}
+
+int requestVblankEvent(int fd, uint32_t crtcIndex, DrmEventListener *listener)
+{
+	drmVBlank vbl;
+	memset(&vbl, 0, sizeof(vbl));
+	vbl.request.type = static_cast<drmVBlankSeqType>(DRM_VBLANK_RELATIVE | DRM_VBLANK_EVENT |
+	                                                 vblankCrtcType(crtcIndex));
+	vbl.request.sequence = 1;
+	vbl.request.signal = reinterpret_cast<unsigned long>(listener);
+
+	if (drmWaitVBlank(fd, &vbl))
+	{
+		return -errno;
+	}
+	return 0;
+}
+
+int queryVblank(int fd, uint32_t crtcIndex, uint32_t &sequence)
+{
+	//A relative wait for 0 vblanks returns the current count without sleeping
+	drmVBlank vbl;
+	memset(&vbl, 0, sizeof(vbl));
+	vbl.request.type = static_cast<drmVBlankSeqType>(DRM_VBLANK_RELATIVE | vblankCrtcType(crtcIndex));
+	vbl.request.sequence = 0;
+
+	if (drmWaitVBlank(fd, &vbl))
+	{
+		return -errno;
+	}
+	sequence = vbl.reply.sequence;
+	return 0;
+}
+
+gboolean dispatchDrmEvents(gint fd, GIOCondition condition, gpointer userData)
+{
+	if (condition & (G_IO_ERR | G_IO_HUP | G_IO_NVAL))
+	{
+		LOG_ERROR(MSGID_DEVICE_ERROR, 0, "DRM event fd %d closed", fd);
+		return G_SOURCE_REMOVE;
+	}
+
+	drmEventContext evctx;
+	memset(&evctx, 0, sizeof(evctx));
+	evctx.version = 2;
+	evctx.vblank_handler = vblankHandler;
+	evctx.page_flip_handler = pageFlipHandler;
+
+	if (drmHandleEvent(fd, &evctx))
+	{
+		LOG_ERROR(MSGID_DEVICE_ERROR, 0, "drmHandleEvent failed: %s", strerror(errno));
+	}
+	return G_SOURCE_CONTINUE;
+}
@@ -0,0 +1,38 @@
+// Copyright (c) 2017-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <cstdint>
+#include <glib.h>
+
+//Receiver of DRM vblank and page flip events. The listener address is the
+//user data of the request, so it must stay valid until the event arrives.
+class DrmEventListener
+{
+public:
+	virtual ~DrmEventListener() {}
+	virtual void onVblank(unsigned int sequence, unsigned int tvSec, unsigned int tvUsec) {}
+	virtual void onPageFlip(unsigned int sequence, unsigned int tvSec, unsigned int tvUsec) {}
+};
+
+//Ask for a vblank event on the next vblank of the crtc at crtcIndex.
+int requestVblankEvent(int fd, uint32_t crtcIndex, DrmEventListener *listener);
+//Current vblank count of the crtc at crtcIndex, without waiting.
+int queryVblank(int fd, uint32_t crtcIndex, uint32_t &sequence);
+
+//GLib unix fd callback, reads all pending events from the DRM fd.
+gboolean dispatchDrmEvents(gint fd, GIOCondition condition, gpointer userData);
@@ -0,0 +1,32 @@
+// Copyright (c) 2017-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+
+#include "drmResources.h"
+
+std::atomic<int64_t> DrmResourceArena::sLiveObjects(0);
+
+void DrmResourceArena::clear()
+{
+	//Newest first, in case an object ever refers to one read before it
+	for (auto obj = mObjects.rbegin(); obj != mObjects.rend(); ++obj)
+	{
+		obj->free(obj->obj);
+	}
+	sLiveObjects -= static_cast<int64_t>(mObjects.size());
+	mObjects.clear();
+}
@@ -0,0 +1,92 @@
+// Copyright (c) 2017-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <xf86drmMode.h>
+
+//Releases a libdrm object with its matching drmModeFree* call
+struct DrmObjectDeleter
+{
+	void operator()(drmModeConnector *obj) const { drmModeFreeConnector(obj); }
+	void operator()(drmModeCrtc *obj) const { drmModeFreeCrtc(obj); }
+	void operator()(drmModeEncoder *obj) const { drmModeFreeEncoder(obj); }
+	void operator()(drmModePlane *obj) const { drmModeFreePlane(obj); }
+};
+
+template <typename T>
+using DrmObjectPtr = std::unique_ptr<T, DrmObjectDeleter>;
+
+//Owns the libdrm objects read by one enumeration pass of a device. Objects are
+//handed out as plain pointers, valid for as long as the arena, and are all
+//released together when a newer snapshot replaces it or the device goes away.
+class DrmResourceArena
+{
+public:
+	DrmResourceArena() {}
+	~DrmResourceArena() { clear(); }
+
+	DrmResourceArena(const DrmResourceArena&) = delete;
+	DrmResourceArena& operator=(const DrmResourceArena&) = delete;
+	DrmResourceArena(DrmResourceArena &&other) { mObjects.swap(other.mObjects); }
+	DrmResourceArena& operator=(DrmResourceArena &&other)
+	{
+		if (this != &other)
+		{
+			clear();
+			mObjects.swap(other.mObjects);
+		}
+		return *this;
+	}
+
+	//Takes ownership of obj, null is passed through
+	template <typename T>
+	T* adopt(T *obj)
+	{
+		if (obj)
+		{
+			mObjects.push_back(Object{obj, &release<T>});
+			sLiveObjects++;
+		}
+		return obj;
+	}
+
+	void clear();
+	size_t size() const { return mObjects.size(); }
+
+	//Objects owned by all arenas of the process, for leak checks
+	static std::atomic<int64_t> sLiveObjects;
+
+private:
+	struct Object
+	{
+		void *obj;
+		void (*free)(void*);
+	};
+
+	template <typename T>
+	static void release(void *obj)
+	{
+		DrmObjectDeleter()(static_cast<T*>(obj));
+	}
+
+	std::vector<Object> mObjects;
+};
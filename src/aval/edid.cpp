@@ -0,0 +1,398 @@
+// Copyright (c) 2017-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+
+#include <cstring>
+#include "edid.h"
+
+namespace
+{
+
+const unsigned char EDID_HEADER[8] = {0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00};
+const size_t EDID_DESCRIPTORS = 0x36; //four 18 byte descriptors
+const size_t DESCRIPTOR_SIZE = 18;
+const uint8_t CEA_EXTENSION_TAG = 0x02;
+const uint8_t DESCRIPTOR_MONITOR_NAME = 0xfc;
+
+const uint8_t CEA_AUDIO_BLOCK = 1;
+const uint8_t CEA_VIDEO_BLOCK = 2;
+const uint8_t CEA_VENDOR_BLOCK = 3;
+const uint32_t HDMI_OUI = 0x000c03;
+
+}
+
+const unsigned char* EdidView::block(size_t index) const
+{
+	if ((index + 1) * BLOCK_SIZE > mLen)
+	{
+		return nullptr;
+	}
+	return mData + index * BLOCK_SIZE;
+}
+
+bool EdidView::blockChecksumOk(size_t index) const
+{
+	const unsigned char *b = block(index);
+	if (!b)
+	{
+		return false;
+	}
+	uint8_t sum = 0;
+	for (size_t i = 0; i < BLOCK_SIZE; i++)
+	{
+		sum += b[i];
+	}
+	return sum == 0;
+}
+
+bool EdidView::valid() const
+{
+	return mLen >= BLOCK_SIZE && !memcmp(mData, EDID_HEADER, sizeof(EDID_HEADER)) && blockChecksumOk(0);
+}
+
+size_t EdidView::blockCount() const
+{
+	if (!valid())
+	{
+		return 0;
+	}
+	size_t announced = 1 + mData[126];
+	size_t present = mLen / BLOCK_SIZE;
+	return announced < present ? announced : present;
+}
+
+void EdidView::manufacturer(char id[4]) const
+{
+	id[0] = id[1] = id[2] = id[3] = 0;
+	if (!valid())
+	{
+		return;
+	}
+	uint16_t packed = (mData[8] << 8) | mData[9];
+	id[0] = '@' + ((packed >> 10) & 0x1f);
+	id[1] = '@' + ((packed >> 5) & 0x1f);
+	id[2] = '@' + (packed & 0x1f);
+}
+
+uint16_t EdidView::productCode() const
+{
+	return valid() ? mData[10] | (mData[11] << 8) : 0;
+}
+
+uint32_t EdidView::serialNumber() const
+{
+	return valid() ? mData[12] | (mData[13] << 8) | (mData[14] << 16) | (uint32_t(mData[15]) << 24) : 0;
+}
+
+uint8_t EdidView::week() const
+{
+	return valid() ? mData[16] : 0;
+}
+
+uint16_t EdidView::year() const
+{
+	return valid() ? 1990 + mData[17] : 0;
+}
+
+uint8_t EdidView::version() const
+{
+	return valid() ? mData[18] : 0;
+}
+
+uint8_t EdidView::revision() const
+{
+	return valid() ? mData[19] : 0;
+}
+
+bool EdidView::digitalInput() const
+{
+	return valid() && (mData[20] & 0x80);
+}
+
+uint8_t EdidView::widthCm() const
+{
+	return valid() ? mData[21] : 0;
+}
+
+uint8_t EdidView::heightCm() const
+{
+	return valid() ? mData[22] : 0;
+}
+
+size_t EdidView::monitorName(char *name, size_t size) const
+{
+	if (!size)
+	{
+		return 0;
+	}
+	name[0] = 0;
+	if (!valid())
+	{
+		return 0;
+	}
+	for (size_t i = 0; i < 4; i++)
+	{
+		const unsigned char *desc = mData + EDID_DESCRIPTORS + i * DESCRIPTOR_SIZE;
+		if (isTiming(desc) || desc[3] != DESCRIPTOR_MONITOR_NAME)
+		{
+			continue;
+		}
+		//Up to 13 characters, terminated by a line feed when shorter
+		size_t len = 0;
+		while (len < 13 && len + 1 < size && desc[5 + len] != 0x0a)
+		{
+			name[len] = desc[5 + len];
+			len++;
+		}
+		while (len && name[len - 1] == ' ')
+		{
+			len--;
+		}
+		name[len] = 0;
+		return len;
+	}
+	return 0;
+}
+
+void EdidView::decodeTiming(const unsigned char *d, EdidDetailedTiming &t)
+{
+	t.pixelClockKHz = (d[0] | (d[1] << 8)) * 10;
+	t.hActive = d[2] | ((d[4] & 0xf0) << 4);
+	t.hBlank = d[3] | ((d[4] & 0x0f) << 8);
+	t.vActive = d[5] | ((d[7] & 0xf0) << 4);
+	t.vBlank = d[6] | ((d[7] & 0x0f) << 8);
+	t.hSyncOffset = d[8] | ((d[11] & 0xc0) << 2);
+	t.hSyncWidth = d[9] | ((d[11] & 0x30) << 4);
+	t.vSyncOffset = (d[10] >> 4) | ((d[11] & 0x0c) << 2);
+	t.vSyncWidth = (d[10] & 0x0f) | ((d[11] & 0x03) << 4);
+	t.widthMm = d[12] | ((d[14] & 0xf0) << 4);
+	t.heightMm = d[13] | ((d[14] & 0x0f) << 8);
+	t.interlaced = d[17] & 0x80;
+	bool digitalSeparate = (d[17] & 0x18) == 0x18;
+	t.vSyncPositive = digitalSeparate && (d[17] & 0x04);
+	t.hSyncPositive = (d[17] & 0x10) && (d[17] & 0x02);
+}
+
+size_t EdidView::detailedTimingCount() const
+{
+	size_t count = 0;
+	EdidDetailedTiming timing;
+	while (detailedTiming(count, timing))
+	{
+		count++;
+	}
+	return count;
+}
+
+bool EdidView::detailedTiming(size_t index, EdidDetailedTiming &timing) const
+{
+	if (!valid())
+	{
+		return false;
+	}
+	for (size_t i = 0; i < 4; i++)
+	{
+		const unsigned char *desc = mData + EDID_DESCRIPTORS + i * DESCRIPTOR_SIZE;
+		if (isTiming(desc) && !index--)
+		{
+			decodeTiming(desc, timing);
+			return true;
+		}
+	}
+	const unsigned char *cea;
+	for (size_t ext = 0; (cea = ceaBlock(ext)); ext++)
+	{
+		//Timings follow the data blocks and end at the first zero pixel clock
+		for (size_t off = cea[2]; off >= 4 && off + DESCRIPTOR_SIZE < BLOCK_SIZE; off += DESCRIPTOR_SIZE)
+		{
+			if (!isTiming(cea + off))
+			{
+				break;
+			}
+			if (!index--)
+			{
+				decodeTiming(cea + off, timing);
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+const unsigned char* EdidView::ceaBlock(size_t index) const
+{
+	size_t count = blockCount();
+	for (size_t i = 1; i < count; i++)
+	{
+		const unsigned char *b = mData + i * BLOCK_SIZE;
+		if (b[0] == CEA_EXTENSION_TAG && blockChecksumOk(i) && !index--)
+		{
+			return b;
+		}
+	}
+	return nullptr;
+}
+
+uint8_t EdidView::ceaRevision() const
+{
+	const unsigned char *cea = ceaBlock(0);
+	return cea ? cea[1] : 0;
+}
+
+bool EdidView::underscan() const
+{
+	const unsigned char *cea = ceaBlock(0);
+	return cea && cea[1] >= 2 && (cea[3] & 0x80);
+}
+
+bool EdidView::basicAudio() const
+{
+	const unsigned char *cea = ceaBlock(0);
+	return cea && cea[1] >= 2 && (cea[3] & 0x40);
+}
+
+bool EdidView::ycbcr444() const
+{
+	const unsigned char *cea = ceaBlock(0);
+	return cea && cea[1] >= 2 && (cea[3] & 0x20);
+}
+
+bool EdidView::ycbcr422() const
+{
+	const unsigned char *cea = ceaBlock(0);
+	return cea && cea[1] >= 2 && (cea[3] & 0x10);
+}
+
+const unsigned char* EdidView::dataBlock(uint8_t tag, size_t index, size_t &len) const
+{
+	const unsigned char *cea;
+	for (size_t ext = 0; (cea = ceaBlock(ext)); ext++)
+	{
+		//Revision 1 has no data blocks, byte 2 is where the timings start
+		size_t end = cea[2];
+		if (cea[1] < 3 || end < 4 || end > BLOCK_SIZE - 1)
+		{
+			continue;
+		}
+		for (size_t off = 4; off < end; off += 1 + (cea[off] & 0x1f))
+		{
+			size_t blockLen = cea[off] & 0x1f;
+			if (off + 1 + blockLen > end)
+			{
+				break; //malformed, the block runs into the timings
+			}
+			if ((cea[off] >> 5) == tag && !index--)
+			{
+				len = blockLen;
+				return cea + off + 1;
+			}
+		}
+	}
+	return nullptr;
+}
+
+size_t EdidView::vicCount() const
+{
+	size_t count = 0;
+	size_t len;
+	for (size_t i = 0; dataBlock(CEA_VIDEO_BLOCK, i, len); i++)
+	{
+		count += len;
+	}
+	return count;
+}
+
+bool EdidView::vic(size_t index, uint8_t &code, bool &native) const
+{
+	size_t len;
+	const unsigned char *svd;
+	for (size_t i = 0; (svd = dataBlock(CEA_VIDEO_BLOCK, i, len)); i++)
+	{
+		if (index >= len)
+		{
+			index -= len;
+			continue;
+		}
+		//Bit 7 flags a native format only for VICs 1-64, 193-253 are plain VICs
+		uint8_t value = svd[index];
+		native = (value & 0x80) && (value & 0x7f) >= 1 && (value & 0x7f) <= 64;
+		code = native ? value & 0x7f : value;
+		return true;
+	}
+	return false;
+}
+
+size_t EdidView::shortAudioCount() const
+{
+	size_t count = 0;
+	size_t len;
+	for (size_t i = 0; dataBlock(CEA_AUDIO_BLOCK, i, len); i++)
+	{
+		count += len / 3;
+	}
+	return count;
+}
+
+bool EdidView::shortAudio(size_t index, EdidShortAudio &sad) const
+{
+	size_t len;
+	const unsigned char *block;
+	for (size_t i = 0; (block = dataBlock(CEA_AUDIO_BLOCK, i, len)); i++)
+	{
+		if (index >= len / 3)
+		{
+			index -= len / 3;
+			continue;
+		}
+		const unsigned char *d = block + index * 3;
+		sad.format = (d[0] >> 3) & 0x0f;
+		sad.maxChannels = (d[0] & 0x07) + 1;
+		sad.sampleRates = d[1] & 0x7f;
+		sad.detail = d[2];
+		return true;
+	}
+	return false;
+}
+
+bool EdidView::hdmiVsdb(EdidHdmiVsdb &vsdb) const
+{
+	size_t len;
+	const unsigned char *d;
+	for (size_t i = 0; (d = dataBlock(CEA_VENDOR_BLOCK, i, len)); i++)
+	{
+		if (len < 5 || (d[0] | (d[1] << 8) | (uint32_t(d[2]) << 16)) != HDMI_OUI)
+		{
+			continue;
+		}
+		memset(&vsdb, 0, sizeof(vsdb));
+		vsdb.physicalAddress = (d[3] << 8) | d[4];
+		if (len >= 6)
+		{
+			vsdb.supportsAI = d[5] & 0x80;
+			vsdb.deepColor48 = d[5] & 0x40;
+			vsdb.deepColor36 = d[5] & 0x20;
+			vsdb.deepColor30 = d[5] & 0x10;
+			vsdb.deepColorY444 = d[5] & 0x08;
+		}
+		if (len >= 7)
+		{
+			vsdb.maxTmdsClockMHz = d[6] * 5;
+		}
+		return true;
+	}
+	return false;
+}
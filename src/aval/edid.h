@@ -14,97 +14,135 @@
 //
 // SPDX-License-Identifier: Apache-2.0
 
+
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
-#include <string.h>
-typedef unsigned int u32;
-typedef unsigned char u8;
-typedef unsigned short u16;
+#include <memory>
+#include <xf86drmMode.h>
 
+//One 18 byte detailed timing descriptor
+struct EdidDetailedTiming
+{
+	uint32_t pixelClockKHz;
+	uint16_t hActive;
+	uint16_t hBlank;
+	uint16_t hSyncOffset;
+	uint16_t hSyncWidth;
+	uint16_t vActive; //per field when interlaced
+	uint16_t vBlank;
+	uint16_t vSyncOffset;
+	uint16_t vSyncWidth;
+	uint16_t widthMm;
+	uint16_t heightMm;
+	bool interlaced;
+	bool hSyncPositive; //only meaningful with digital separate sync
+	bool vSyncPositive;
+};
 
-//This is a place holder for extracting information from Edid.
-class Edid {
-private:
+//CEA-861 short audio descriptor
+struct EdidShortAudio
+{
+	uint8_t format; //1 LPCM, 2 AC-3, ... 15 extended
+	uint8_t maxChannels;
+	uint8_t sampleRates; //bit 0 32 kHz ... bit 6 192 kHz
+	uint8_t detail; //LPCM: bit depths (16/20/24), formats 2-8: max bitrate / 8 kbps
+};
 
-	char manuf_name[4];
-	unsigned int model;
-	unsigned int serial;
-	unsigned int year;
-	unsigned int week;
-	unsigned int version[2];
-	unsigned int nonconformant;
-	unsigned int type;	unsigned int bpp;
-	unsigned int xres;
-	unsigned int yres;
-	unsigned int voltage;
-	unsigned int sync;
-	unsigned int xsize_cm;
-	unsigned int ysize_cm;
-	/* used to compute timing for graphics chips. */
-	unsigned char phsync;
-	unsigned char pvsync;
-	unsigned int x_mm;
-	unsigned int y_mm;
-	unsigned int pixel_clock;
-	unsigned int link_clock;
-	unsigned int ha;
-	unsigned int hbl;
-	unsigned int hso;
-	unsigned int hspw;
-	unsigned int hborder;
-	unsigned int va;
-	unsigned int vbl;
-	unsigned int vso;
-	unsigned int vspw;
-	unsigned int vborder;
-	/* 3 variables needed for coreboot framebuffer.
-	 * In most cases, they are the same as the ha
-	 * and va variables, but not always, as in the
-	 * case of a 1366 wide display.
-	 */
-	u32 x_resolution;
-	u32 y_resolution;
-	u32 bytes_per_line;
-	/* it is unlikely we need these things. */
-	/* if one of these is non-zero, use that one. */
-	unsigned int aspect_landscape;
-	unsigned int aspect_portrait;
-	const char *range_class;
-	const char *syncmethod;
-	const char *stereo;
-//	void set_vbe_mode_info_valid(struct edid *edid, uintptr_t fb_addr);
-
-	unsigned char* mBlob = nullptr;
-	int mEdidLen=0;
+//HDMI 1.4 vendor specific data block
+struct EdidHdmiVsdb
+{
+	uint16_t physicalAddress; //A.B.C.D, one nibble each
+	bool supportsAI;
+	bool deepColor30;
+	bool deepColor36;
+	bool deepColor48;
+	bool deepColorY444;
+	uint16_t maxTmdsClockMHz; //0 if not given
+};
+
+//Decodes an EDID in place. Holds only a pointer to the blob, which must outlive
+//the view, and never allocates. Every accessor walks the blob on demand.
+//Extension blocks with a bad checksum are ignored.
+class EdidView
+{
 public:
-	Edid(unsigned char *edid, int size)
-	{
-		mBlob = (unsigned char*) malloc(sizeof(unsigned char) * size);
-		memcpy(mBlob, edid, size);
-		mEdidLen = size;
-	}
+	static const size_t BLOCK_SIZE = 128;
 
-	Edid() {}
+	EdidView(const unsigned char *data, size_t len) : mData(data), mLen(data ? len : 0) {}
 
-	Edid (const Edid &other) {
-		Edid(other.mBlob, other.mEdidLen);
-	};
+	//Header and base block checksum are correct
+	bool valid() const;
+	//Base block plus the extensions actually present in the blob
+	size_t blockCount() const;
+	bool blockChecksumOk(size_t block) const;
 
-	~Edid()
-	{
-		if (mBlob)
-		{
-			delete mBlob;
-			mBlob = nullptr;
-		}
-	}
+	//Base block
+	void manufacturer(char id[4]) const; //three letter PNP id
+	uint16_t productCode() const;
+	uint32_t serialNumber() const;
+	uint8_t week() const;
+	uint16_t year() const;
+	uint8_t version() const;
+	uint8_t revision() const;
+	bool digitalInput() const;
+	uint8_t widthCm() const;
+	uint8_t heightCm() const;
+	//Copies the monitor name descriptor, returns its length, 0 if there is none
+	size_t monitorName(char *name, size_t size) const;
+
+	//Detailed timings of the base block followed by those of the CEA extensions.
+	//The first one is the preferred timing.
+	size_t detailedTimingCount() const;
+	bool detailedTiming(size_t index, EdidDetailedTiming &timing) const;
+
+	//CEA-861 extension, values of the first valid one
+	bool hasCea() const { return ceaBlock(0) != nullptr; }
+	uint8_t ceaRevision() const;
+	bool underscan() const;
+	bool basicAudio() const;
+	bool ycbcr444() const;
+	bool ycbcr422() const;
+
+	//Short video descriptors of all video data blocks
+	size_t vicCount() const;
+	bool vic(size_t index, uint8_t &code, bool &native) const;
+	size_t shortAudioCount() const;
+	bool shortAudio(size_t index, EdidShortAudio &sad) const;
+	bool hdmiVsdb(EdidHdmiVsdb &vsdb) const;
+
+private:
+	const unsigned char* block(size_t index) const;
+	const unsigned char* ceaBlock(size_t index) const; //index-th valid CEA extension
+	//Payload and length of the index-th CEA data block with this tag, null if none
+	const unsigned char* dataBlock(uint8_t tag, size_t index, size_t &len) const;
+	static bool isTiming(const unsigned char *desc) { return desc[0] || desc[1]; }
+	static void decodeTiming(const unsigned char *desc, EdidDetailedTiming &timing);
+
+	const unsigned char *mData;
+	size_t mLen;
+};
+
+//EDID of a connector. Keeps the property blob read from the kernel alive,
+//copies share it instead of duplicating the bytes.
+class Edid
+{
+public:
+	Edid() {}
+	explicit Edid(drmModePropertyBlobPtr blob) : mBlob(blob, drmModeFreePropertyBlob) {}
+
+	//Raw blob as read from the connector's EDID property, null if the sink has none
+	const unsigned char* data() const { return mBlob ? static_cast<const unsigned char*>(mBlob->data) : nullptr; }
+	int size() const { return mBlob ? static_cast<int>(mBlob->length) : 0; }
+	EdidView view() const { return EdidView(data(), size()); }
 
 	friend std::ostream& operator<< (std::ostream &os, const Edid &edid)
 	{
-		for (int j = 0; j < edid.mEdidLen; j++)
+		for (int j = 0; j < edid.size(); j++)
 		{
-			os << *(edid.mBlob + j);
+			os << *(edid.data() + j);
 			if (!((j + 1) % 8))
 			{
 				os << std::endl;
@@ -112,4 +150,7 @@ public:
 		}
 		return os;
 	}
+
+private:
+	std::shared_ptr<drmModePropertyBlobRes> mBlob;
 };
@@ -0,0 +1,296 @@
+// Copyright (c) 2017-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <functional>
+#include <inttypes.h>
+#include <set>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <glib.h>
+#include "edidCache.h"
+#include "logging.h"
+
+namespace
+{
+
+const uint32_t EDID_CACHE_MAGIC = 0x43444541; //"AEDC"
+const uint32_t EDID_CACHE_VERSION = 1;
+const uint32_t EDID_CACHE_MAX_MODES = 256;
+const uint32_t EDID_CACHE_MAX_EDID = 32768; //128 byte blocks, the extension count is one byte
+const size_t EDID_CACHE_MAX_ENTRIES = 16; //a handful of outputs and the sinks they have seen
+const char EDID_CACHE_ENTRY_SUFFIX[] = ".modes";
+const char EDID_CACHE_LINK_SUFFIX[] = ".last";
+
+struct EdidCacheHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t hash;
+	uint32_t edidLen;
+	uint32_t modeSize; //sizeof(drmModeModeInfo) of the writer
+	uint32_t modeCount;
+	int32_t preferred;
+};
+
+bool hasSuffix(const std::string &name, const char *suffix)
+{
+	size_t len = strlen(suffix);
+	return name.size() > len && !name.compare(name.size() - len, len, suffix);
+}
+
+//Unique per thread, cards are enumerated in parallel and two of them may see the same sink
+std::string tmpPath(const std::string &file)
+{
+	return file + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+}
+
+}
+
+uint64_t EdidCache::hash(const unsigned char *edid, size_t len)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < len; i++)
+	{
+		hash ^= edid[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+std::string EdidCache::path(uint64_t hash) const
+{
+	char name[32];
+	snprintf(name, sizeof(name), "/%016" PRIx64 "%s", hash, EDID_CACHE_ENTRY_SUFFIX);
+	return mDir + name;
+}
+
+std::string EdidCache::linkPath(const std::string &output) const
+{
+	return mDir + "/" + output + EDID_CACHE_LINK_SUFFIX;
+}
+
+bool EdidCache::read(const std::string &file, uint64_t key, const unsigned char *edid, size_t len,
+                     EdidModeTable &table) const
+{
+	FILE *fp = fopen(file.c_str(), "rb");
+	if (!fp)
+	{
+		return false; //never seen this sink
+	}
+
+	bool ok = false;
+	EdidCacheHeader header;
+	std::vector<unsigned char> stored;
+	if (fread(&header, sizeof(header), 1, fp) == 1 &&
+	    header.magic == EDID_CACHE_MAGIC && header.version == EDID_CACHE_VERSION &&
+	    header.hash == key && header.edidLen <= EDID_CACHE_MAX_EDID && (!edid || header.edidLen == len) &&
+	    header.modeSize == sizeof(drmModeModeInfo) && header.modeCount <= EDID_CACHE_MAX_MODES &&
+	    header.preferred >= -1 && header.preferred < int32_t(header.modeCount))
+	{
+		stored.resize(header.edidLen);
+		table.modes.resize(header.modeCount);
+		ok = fread(stored.data(), 1, stored.size(), fp) == stored.size() &&
+		     (!edid || !memcmp(stored.data(), edid, len)) &&
+		     (!header.modeCount || fread(table.modes.data(), sizeof(drmModeModeInfo), header.modeCount, fp) == header.modeCount);
+		table.preferred = header.preferred;
+	}
+	fclose(fp);
+
+	if (!ok)
+	{
+		LOG_ERROR(MSGID_EDID_CACHE_ERROR, 0, "Ignoring stale or corrupt EDID cache entry %s", file.c_str());
+		table = EdidModeTable();
+	}
+	return ok;
+}
+
+bool EdidCache::load(const unsigned char *edid, size_t len, EdidModeTable &table) const
+{
+	if (!edid || !len)
+	{
+		return false;
+	}
+	uint64_t key = hash(edid, len);
+	std::lock_guard<std::mutex> lock(mLock);
+	return read(path(key), key, edid, len, table);
+}
+
+bool EdidCache::readLink(const std::string &output, uint64_t &edidHash) const
+{
+	FILE *fp = fopen(linkPath(output).c_str(), "r");
+	if (!fp)
+	{
+		return false;
+	}
+	bool ok = fscanf(fp, "%" SCNx64, &edidHash) == 1;
+	fclose(fp);
+	return ok;
+}
+
+bool EdidCache::writeLink(const std::string &output, uint64_t edidHash) const
+{
+	std::string file = linkPath(output);
+	std::string tmp = tmpPath(file);
+	FILE *fp = fopen(tmp.c_str(), "w");
+	if (!fp)
+	{
+		LOG_ERROR(MSGID_EDID_CACHE_ERROR, 0, "Cannot write EDID cache link %s: %s", tmp.c_str(), strerror(errno));
+		return false;
+	}
+	bool ok = fprintf(fp, "%016" PRIx64 "\n", edidHash) > 0;
+	ok = !fclose(fp) && ok;
+	if (!ok || rename(tmp.c_str(), file.c_str()) < 0)
+	{
+		LOG_ERROR(MSGID_EDID_CACHE_ERROR, 0, "Failed to store EDID cache link %s", file.c_str());
+		unlink(tmp.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool EdidCache::loadLast(const std::string &output, EdidModeTable &table, uint64_t &edidHash) const
+{
+	std::lock_guard<std::mutex> lock(mLock);
+	uint64_t key;
+	if (output.empty() || !readLink(output, key) || !read(path(key), key, nullptr, 0, table))
+	{
+		return false;
+	}
+	edidHash = key;
+	return true;
+}
+
+bool EdidCache::remember(const std::string &output, uint64_t edidHash) const
+{
+	std::lock_guard<std::mutex> lock(mLock);
+	uint64_t linked;
+	if (readLink(output, linked) && linked == edidHash)
+	{
+		return true; //spare the flash
+	}
+	return writeLink(output, edidHash);
+}
+
+void EdidCache::prune() const
+{
+	DIR *dir = opendir(mDir.c_str());
+	if (!dir)
+	{
+		return;
+	}
+	std::vector<std::pair<time_t, std::string>> entries;
+	std::set<std::string> linked;
+	while (struct dirent *ent = readdir(dir))
+	{
+		std::string name = ent->d_name;
+		uint64_t key;
+		if (hasSuffix(name, EDID_CACHE_LINK_SUFFIX) &&
+		    readLink(name.substr(0, name.size() - strlen(EDID_CACHE_LINK_SUFFIX)), key))
+		{
+			linked.insert(path(key));
+			continue;
+		}
+		struct stat st;
+		std::string file = mDir + "/" + name;
+		if (hasSuffix(name, EDID_CACHE_ENTRY_SUFFIX) && !stat(file.c_str(), &st))
+		{
+			entries.emplace_back(st.st_mtime, file);
+		}
+	}
+	closedir(dir);
+
+	//Oldest first, the sinks outputs last saw are never removed
+	std::sort(entries.begin(), entries.end());
+	size_t count = entries.size();
+	for (auto &entry : entries)
+	{
+		if (count <= EDID_CACHE_MAX_ENTRIES)
+		{
+			break;
+		}
+		if (linked.count(entry.second))
+		{
+			continue;
+		}
+		if (unlink(entry.second.c_str()) < 0)
+		{
+			LOG_ERROR(MSGID_EDID_CACHE_ERROR, 0, "Cannot remove EDID cache entry %s: %s", entry.second.c_str(),
+			          strerror(errno));
+			continue;
+		}
+		LOG_DEBUG("Removed EDID cache entry %s", entry.second.c_str());
+		count--;
+	}
+}
+
+bool EdidCache::store(const std::string &output, const unsigned char *edid, size_t len, const EdidModeTable &table) const
+{
+	if (!edid || !len || len > EDID_CACHE_MAX_EDID || table.modes.size() > EDID_CACHE_MAX_MODES)
+	{
+		return false;
+	}
+	std::lock_guard<std::mutex> lock(mLock);
+	if (g_mkdir_with_parents(mDir.c_str(), 0755) < 0)
+	{
+		LOG_ERROR(MSGID_EDID_CACHE_ERROR, 0, "Cannot create EDID cache dir %s: %s", mDir.c_str(), strerror(errno));
+		return false;
+	}
+
+	EdidCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = EDID_CACHE_MAGIC;
+	header.version = EDID_CACHE_VERSION;
+	header.hash = hash(edid, len);
+	header.edidLen = static_cast<uint32_t>(len);
+	header.modeSize = sizeof(drmModeModeInfo);
+	header.modeCount = static_cast<uint32_t>(table.modes.size());
+	header.preferred = table.preferred;
+
+	std::string file = path(header.hash);
+	std::string tmp = tmpPath(file);
+	FILE *fp = fopen(tmp.c_str(), "wb");
+	if (!fp)
+	{
+		LOG_ERROR(MSGID_EDID_CACHE_ERROR, 0, "Cannot write EDID cache entry %s: %s", tmp.c_str(), strerror(errno));
+		return false;
+	}
+	bool ok = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+	          fwrite(edid, 1, len, fp) == len &&
+	          (table.modes.empty() ||
+	           fwrite(table.modes.data(), sizeof(drmModeModeInfo), table.modes.size(), fp) == table.modes.size());
+	ok = !fclose(fp) && ok;
+	if (!ok || rename(tmp.c_str(), file.c_str()) < 0)
+	{
+		LOG_ERROR(MSGID_EDID_CACHE_ERROR, 0, "Failed to store EDID cache entry %s", file.c_str());
+		unlink(tmp.c_str());
+		return false;
+	}
+	LOG_DEBUG("Stored %zu modes for EDID %016" PRIx64, table.modes.size(), header.hash);
+	if (!output.empty())
+	{
+		writeLink(output, header.hash);
+	}
+	prune();
+	return true;
+}
@@ -0,0 +1,73 @@
+// Copyright (c) 2017-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <xf86drmMode.h>
+
+//Modes the kernel derived from an EDID
+struct EdidModeTable
+{
+	std::vector<drmModeModeInfo> modes; //in the kernel's order
+	int preferred = -1; //index into modes, -1 if the sink marked none
+};
+
+//On disk cache of mode tables, one file per EDID named after its content hash.
+//Lets the next boot offer a sink's modes before it has been probed over DDC.
+//The kernel has no EDID either until that probe, so each output also remembers
+//the hash of the sink last seen on it and is served by name. The EDID itself
+//is stored too, so a hash collision is never served by load.
+//At most EDID_CACHE_MAX_ENTRIES mode tables are kept, the oldest that no
+//output refers to are removed first. Safe to use from several threads.
+class EdidCache
+{
+public:
+	explicit EdidCache(const std::string &dir) : mDir(dir) {}
+
+	//64 bit FNV-1a of the EDID blob
+	static uint64_t hash(const unsigned char *edid, size_t len);
+
+	//False if there is no entry for exactly this EDID or it could not be read
+	bool load(const unsigned char *edid, size_t len, EdidModeTable &table) const;
+	//Modes of the sink last stored for an output, e.g. "vc4-HDMI-A-1", and its EDID
+	//hash. Unverified: the sink may have changed since, check the hash after a probe.
+	bool loadLast(const std::string &output, EdidModeTable &table, uint64_t &edidHash) const;
+	//Written to a temporary file and renamed, so a crash never leaves a torn entry.
+	//Also makes it the entry loadLast serves for output.
+	bool store(const std::string &output, const unsigned char *edid, size_t len, const EdidModeTable &table) const;
+	//Serve an already stored entry for output, a no-op if it already is
+	bool remember(const std::string &output, uint64_t edidHash) const;
+
+private:
+	std::string path(uint64_t hash) const;
+	std::string linkPath(const std::string &output) const;
+	//Reads an entry, checking it against the EDID unless edid is null
+	bool read(const std::string &file, uint64_t key, const unsigned char *edid, size_t len,
+	          EdidModeTable &table) const;
+	bool readLink(const std::string &output, uint64_t &edidHash) const;
+	bool writeLink(const std::string &output, uint64_t edidHash) const;
+	void prune() const;
+
+	std::string mDir;
+	mutable std::mutex mLock; //cards are enumerated on parallel threads
+};
@@ -0,0 +1,185 @@
+// Copyright (c) 2017-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+#include <algorithm>
+#include <cstring>
+#include <xf86drm.h>
+#include "formatNegotiation.h"
+#include "pixelFormat.h"
+
+namespace
+{
+
+const uint32_t PRIMARY_YUV_COST = 8;  //keeps the primary plane free for the output's fb
+const uint32_t CONVERT_COST = 1000;   //above any direct path
+
+bool isLinear(uint64_t modifier)
+{
+	return modifier == DRM_FORMAT_MOD_LINEAR || modifier == DRM_FORMAT_MOD_INVALID;
+}
+
+//Bits per pixel read over all planes, 32 for formats missing from format_info
+uint32_t bitsPerPixel(uint32_t format)
+{
+	const struct util_format_info *info = util_format_info_find(format);
+	return info ? info->bpp * util_format_virtual_height(*info, 16) / 16 : 32;
+}
+
+bool isYuv(uint32_t format)
+{
+	const struct util_format_info *info = util_format_info_find(format);
+	return info && info->yuv.order;
+}
+
+//Formats a CPU pass writes without losing precision of 8 bit content
+bool isConversionTarget(uint32_t format)
+{
+	const struct util_format_info *info = util_format_info_find(format);
+	return info && info->planes == 1 && info->bpp == 32 && info->rgb.red.length == 8;
+}
+
+}
+
+void PlaneFormatSet::load(int fd, const drmModePlane *plane, uint32_t inFormatsBlobId)
+{
+	mModifiers.clear();
+	mOrder.clear();
+	mHasModifiers = false;
+
+	drmModePropertyBlobPtr blob = inFormatsBlobId ? drmModeGetPropertyBlob(fd, inFormatsBlobId) : nullptr;
+	if (blob && blob->length >= sizeof(struct drm_format_modifier_blob))
+	{
+		const uint8_t *data = static_cast<const uint8_t*>(blob->data);
+		const struct drm_format_modifier_blob *header = reinterpret_cast<const struct drm_format_modifier_blob*>(data);
+		const uint32_t *formats = reinterpret_cast<const uint32_t*>(data + header->formats_offset);
+		const struct drm_format_modifier *modifiers =
+			reinterpret_cast<const struct drm_format_modifier*>(data + header->modifiers_offset);
+		if (header->formats_offset + header->count_formats * sizeof(uint32_t) <= blob->length &&
+		    header->modifiers_offset + header->count_modifiers * sizeof(*modifiers) <= blob->length)
+		{
+			mOrder.assign(formats, formats + header->count_formats);
+			//Each modifier applies to up to 64 formats, a bit mask from its offset on
+			for (uint32_t i = 0; i < header->count_modifiers; i++)
+			{
+				for (uint32_t bit = 0; bit < 64; bit++)
+				{
+					uint32_t index = modifiers[i].offset + bit;
+					if (((modifiers[i].formats >> bit) & 1) && index < header->count_formats)
+					{
+						mModifiers[formats[index]].push_back(modifiers[i].modifier);
+					}
+				}
+			}
+			mHasModifiers = true;
+		}
+	}
+	if (blob)
+	{
+		drmModeFreePropertyBlob(blob);
+	}
+
+	if (!mHasModifiers)
+	{
+		mOrder.assign(plane->formats, plane->formats + plane->count_formats);
+		for (uint32_t format : mOrder)
+		{
+			mModifiers[format].push_back(DRM_FORMAT_MOD_LINEAR);
+		}
+	}
+}
+
+bool PlaneFormatSet::supports(uint32_t format, uint64_t modifier) const
+{
+	auto found = mModifiers.find(format);
+	if (found == mModifiers.end())
+	{
+		return false;
+	}
+	if (modifier == DRM_FORMAT_MOD_INVALID)
+	{
+		modifier = DRM_FORMAT_MOD_LINEAR;
+	}
+	return std::find(found->second.begin(), found->second.end(), modifier) != found->second.end();
+}
+
+FormatChoice negotiateFormat(const std::vector<FormatOffer> &offers, const std::vector<FormatCandidate> &planes)
+{
+	FormatChoice best;
+	auto consider = [&best](const FormatChoice &choice)
+	{
+		if (best.path == FORMAT_PATH_NONE || choice.cost < best.cost)
+		{
+			best = choice;
+		}
+	};
+
+	for (size_t i = 0; i < offers.size(); i++)
+	{
+		const FormatOffer &offer = offers[i];
+		for (const FormatCandidate &plane : planes)
+		{
+			FormatChoice choice;
+			choice.planeId = plane.planeId;
+			choice.offer = i;
+			if (plane.formats->supports(offer.format, offer.modifier))
+			{
+				choice.path = FORMAT_PATH_DIRECT;
+				choice.format = offer.format;
+				choice.modifier = offer.modifier;
+				//The client's order only breaks ties
+				choice.cost = bitsPerPixel(offer.format) + i;
+				if (plane.type == DRM_PLANE_TYPE_PRIMARY && isYuv(offer.format))
+				{
+					choice.cost += PRIMARY_YUV_COST;
+				}
+				consider(choice);
+				continue;
+			}
+			//Only a linear buffer of a known layout can be converted on the CPU
+			if (!isLinear(offer.modifier) || !util_format_info_find(offer.format))
+			{
+				continue;
+			}
+			for (uint32_t target : plane.formats->formats())
+			{
+				if (isConversionTarget(target) && plane.formats->supports(target))
+				{
+					choice.path = FORMAT_PATH_CONVERT;
+					choice.format = target;
+					choice.modifier = DRM_FORMAT_MOD_LINEAR;
+					choice.cost = CONVERT_COST + bitsPerPixel(offer.format) + bitsPerPixel(target) + i;
+					consider(choice);
+					break; //the first one in the driver's order
+				}
+			}
+		}
+	}
+	return best;
+}
+
+const char* formatPathName(FORMAT_PATH_T path)
+{
+	switch (path)
+	{
+		case FORMAT_PATH_DIRECT:
+			return "direct";
+		case FORMAT_PATH_CONVERT:
+			return "convert";
+		default:
+			return "none";
+	}
+}
@@ -0,0 +1,85 @@
+// Copyright (c) 2017-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <drm_fourcc.h>
+#include <xf86drmMode.h>
+
+//Formats and modifiers a plane scans out. Read from the IN_FORMATS blob when
+//the driver has one, else from the plane's format list with linear layout only.
+class PlaneFormatSet
+{
+public:
+	void load(int fd, const drmModePlane *plane, uint32_t inFormatsBlobId);
+
+	//DRM_FORMAT_MOD_INVALID (implicit layout) is taken as linear, as dumb buffers are
+	bool supports(uint32_t format, uint64_t modifier = DRM_FORMAT_MOD_LINEAR) const;
+	bool hasFormat(uint32_t format) const { return mModifiers.count(format) != 0; } //with any modifier
+	const std::vector<uint32_t>& formats() const { return mOrder; } //in the driver's order
+	bool hasModifiers() const { return mHasModifiers; } //read from IN_FORMATS
+
+private:
+	std::unordered_map<uint32_t, std::vector<uint64_t>> mModifiers; //fourcc -> modifiers
+	std::vector<uint32_t> mOrder;
+	bool mHasModifiers = false;
+};
+
+//A layout the client can produce, in its order of preference
+struct FormatOffer
+{
+	uint32_t format;
+	uint64_t modifier; //DRM_FORMAT_MOD_LINEAR for plain buffers
+};
+
+typedef enum
+{
+	FORMAT_PATH_NONE = 0, //neither scanned out nor converted
+	FORMAT_PATH_DIRECT,   //the plane scans out the offered buffer
+	FORMAT_PATH_CONVERT   //the client has to convert into format on the CPU first
+} FORMAT_PATH_T;
+
+struct FormatChoice
+{
+	FORMAT_PATH_T path = FORMAT_PATH_NONE;
+	uint32_t planeId = 0;
+	size_t offer = 0;     //index of the offer to produce
+	uint32_t format = 0;  //fourcc the plane scans out
+	uint64_t modifier = DRM_FORMAT_MOD_LINEAR;
+	uint32_t cost = 0;    //relative, lower is cheaper
+};
+
+//A plane that may show the client's buffers
+struct FormatCandidate
+{
+	uint32_t planeId;
+	uint32_t type; //DRM_PLANE_TYPE_*
+	const PlaneFormatSet *formats;
+};
+
+//Cheapest way to show one of the offers on one of the planes. Direct scanout
+//costs the bits per pixel the plane reads, so NV12 (12) beats XRGB8888 (32).
+//Overlays are preferred for YUV, the primary plane carries the output's own
+//fb. A CPU conversion into 32 bit RGB is only chosen if no offer can be
+//scanned out as is and costs a full read and write pass on top.
+FormatChoice negotiateFormat(const std::vector<FormatOffer> &offers, const std::vector<FormatCandidate> &planes);
+const char* formatPathName(FORMAT_PATH_T path);
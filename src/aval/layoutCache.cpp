@@ -0,0 +1,102 @@
+// Copyright (c) 2017-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <algorithm>
+#include "layoutCache.h"
+#include "driElements.h"
+
+constexpr size_t PlaneLayoutCache::MAX_ENTRIES;
+
+bool PlaneLayoutCache::PlaneKey::operator==(const PlaneKey &other) const
+{
+	return planeId == other.planeId && crtcId == other.crtcId && format == other.format &&
+	       crtc_x == other.crtc_x && crtc_y == other.crtc_y &&
+	       crtc_w == other.crtc_w && crtc_h == other.crtc_h &&
+	       src_x == other.src_x && src_y == other.src_y &&
+	       src_w == other.src_w && src_h == other.src_h && zpos == other.zpos &&
+	       alpha == other.alpha && rotation == other.rotation;
+}
+
+void PlaneLayoutCache::buildKey(const std::vector<DrmPlaneState> &layout, std::vector<PlaneKey> &key)
+{
+	key.clear();
+	for (auto &state : layout)
+	{
+		//Disabled planes cannot make a layout fail
+		if (!state.fbId)
+		{
+			continue;
+		}
+		//Without a known format the result is only valid for this very fb
+		uint32_t format = state.format ? state.format : state.fbId;
+		key.push_back(PlaneKey{state.planeId, state.crtcId, format,
+		                       state.crtc_x, state.crtc_y, state.crtc_w, state.crtc_h,
+		                       state.src_x, state.src_y, state.src_w, state.src_h, state.zpos,
+		                       state.alpha, state.rotation});
+	}
+	std::sort(key.begin(), key.end(), [](const PlaneKey &a, const PlaneKey &b) { return a.planeId < b.planeId; });
+}
+
+size_t PlaneLayoutCache::hashKey(const std::vector<PlaneKey> &key)
+{
+	//FNV-1a over the packed fields
+	uint64_t hash = 14695981039346656037ULL;
+	for (auto &plane : key)
+	{
+		const uint32_t fields[] = {plane.planeId, plane.crtcId, plane.format,
+		                           static_cast<uint32_t>(plane.crtc_x), static_cast<uint32_t>(plane.crtc_y),
+		                           plane.crtc_w, plane.crtc_h, plane.src_x, plane.src_y,
+		                           plane.src_w, plane.src_h, plane.zpos, plane.alpha, plane.rotation};
+		for (auto field : fields)
+		{
+			hash ^= field;
+			hash *= 1099511628211ULL;
+		}
+	}
+	return static_cast<size_t>(hash);
+}
+
+bool PlaneLayoutCache::lookup(const std::vector<DrmPlaneState> &layout, bool &valid)
+{
+	buildKey(layout, mScratch);
+	auto entry = mEntries.find(hashKey(mScratch));
+	if (entry == mEntries.end() || entry->second.planes != mScratch)
+	{
+		mMisses++;
+		return false;
+	}
+	mHits++;
+	valid = entry->second.valid;
+	return true;
+}
+
+void PlaneLayoutCache::insert(const std::vector<DrmPlaneState> &layout, bool valid)
+{
+	if (mEntries.size() >= MAX_ENTRIES)
+	{
+		mEntries.clear();
+	}
+	Entry entry;
+	buildKey(layout, entry.planes);
+	size_t hash = hashKey(entry.planes);
+	entry.valid = valid;
+	mEntries[hash] = std::move(entry);
+}
+
+void PlaneLayoutCache::clear()
+{
+	mEntries.clear();
+}
@@ -0,0 +1,77 @@
+// Copyright (c) 2017-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+struct DrmPlaneState;
+
+//Memoizes DRM_MODE_ATOMIC_TEST_ONLY results for multi-plane layouts.
+//A layout is identified by plane, format, source/destination rectangles and
+//zpos of every plane that has a framebuffer attached; the fb id itself is not
+//part of the key so a new video frame with the same geometry still hits.
+class PlaneLayoutCache
+{
+public:
+	static constexpr size_t MAX_ENTRIES = 128;
+
+	bool lookup(const std::vector<DrmPlaneState> &layout, bool &valid);
+	void insert(const std::vector<DrmPlaneState> &layout, bool valid);
+	void clear();
+
+	size_t size() const { return mEntries.size(); }
+	uint64_t hits() const { return mHits; }
+	uint64_t misses() const { return mMisses; }
+
+private:
+	struct PlaneKey
+	{
+		uint32_t planeId;
+		uint32_t crtcId;
+		uint32_t format;
+		int32_t crtc_x;
+		int32_t crtc_y;
+		uint32_t crtc_w;
+		uint32_t crtc_h;
+		uint32_t src_x;
+		uint32_t src_y;
+		uint32_t src_w;
+		uint32_t src_h;
+		uint32_t zpos;
+		uint32_t alpha;
+		uint32_t rotation;
+
+		bool operator==(const PlaneKey &other) const;
+	};
+
+	struct Entry
+	{
+		std::vector<PlaneKey> planes;
+		bool valid;
+	};
+
+	static void buildKey(const std::vector<DrmPlaneState> &layout, std::vector<PlaneKey> &key);
+	static size_t hashKey(const std::vector<PlaneKey> &key);
+
+	std::unordered_map<size_t, Entry> mEntries;
+	std::vector<PlaneKey> mScratch; //reused so lookups do not allocate once warmed up
+	uint64_t mHits = 0;
+	uint64_t mMisses = 0;
+};
@@ -0,0 +1,161 @@
+// Copyright (c) 2017-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include "mappingCache.h"
+#include "buffers.h"
+#include "logging.h"
+
+BoMappingCache& BoMappingCache::instance()
+{
+	static BoMappingCache cache;
+	return cache;
+}
+
+int BoMappingCache::map(struct bo *bo, void **out)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mStats.maps++;
+	if (bo->ptr)
+	{
+		if (!bo->map_refs++)
+		{
+			auto idle = mIdleIndex.find(bo);
+			if (idle != mIdleIndex.end())
+			{
+				mIdle.erase(idle->second);
+				mIdleIndex.erase(idle);
+				mStats.idleBytes -= bo->size;
+			}
+			else
+			{
+				//Mapped through bo_map_dumb, the cache owns it from now on
+				mStats.mappedBytes += bo->size;
+			}
+		}
+		mStats.hits++;
+		*out = bo->ptr;
+		return 0;
+	}
+
+	if (!makeRoom(bo->size))
+	{
+		LOG_ERROR(MSGID_DRM_MODESET_ERROR, 0, "Mapping %zu KiB would exceed the %zu KiB cap, %zu KiB mapped and in use",
+		          bo->size >> 10, mCap >> 10, mStats.mappedBytes >> 10);
+		mStats.failures++;
+		return -ENOMEM;
+	}
+	int ret = bo_map_dumb(bo);
+	if (ret)
+	{
+		mStats.failures++;
+		return ret;
+	}
+	bo->map_refs = 1;
+	mStats.mappedBytes += bo->size;
+	*out = bo->ptr;
+	return 0;
+}
+
+void BoMappingCache::unmap(struct bo *bo)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (!bo->ptr || !bo->map_refs)
+	{
+		return;
+	}
+	if (!--bo->map_refs)
+	{
+		mIdle.push_front(bo);
+		mIdleIndex[bo] = mIdle.begin();
+		mStats.idleBytes += bo->size;
+	}
+}
+
+void BoMappingCache::forget(struct bo *bo)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (!bo->ptr)
+	{
+		return;
+	}
+	if (!bo->map_refs && !mIdleIndex.count(bo))
+	{
+		bo_unmap_dumb(bo); //never mapped through the cache, nothing accounted
+		return;
+	}
+	if (bo->map_refs)
+	{
+		LOG_DEBUG("Destroying bo %u with %u mapping users", bo->handle, bo->map_refs);
+	}
+	release(bo);
+}
+
+void BoMappingCache::setCap(size_t bytes)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mCap = bytes;
+	makeRoom(0);
+}
+
+size_t BoMappingCache::cap()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mCap;
+}
+
+bool BoMappingCache::makeRoom(size_t bytes)
+{
+	while (mStats.mappedBytes + bytes > mCap && !mIdle.empty())
+	{
+		release(mIdle.back());
+		mStats.evictions++;
+	}
+	return mStats.mappedBytes + bytes <= mCap;
+}
+
+void BoMappingCache::release(struct bo *bo)
+{
+	auto idle = mIdleIndex.find(bo);
+	if (idle != mIdleIndex.end())
+	{
+		mIdle.erase(idle->second);
+		mIdleIndex.erase(idle);
+		mStats.idleBytes -= bo->size;
+	}
+	mStats.mappedBytes -= bo->size;
+	bo->map_refs = 0;
+	bo_unmap_dumb(bo);
+}
+
+BoMappingStats BoMappingCache::stats()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mStats;
+}
+
+std::string BoMappingCache::summary()
+{
+	BoMappingStats s = stats();
+	char line[192];
+	snprintf(line, sizeof(line), "bo mappings: %" PRIu64 " maps, %.1f%% reused, %zu KiB mapped (%zu KiB idle), %"
+	         PRIu64 " evicted, %" PRIu64 " failed", s.maps, s.maps ? 100.0 * s.hits / s.maps : 0.0,
+	         s.mappedBytes >> 10, s.idleBytes >> 10, s.evictions, s.failures);
+	return line;
+}
@@ -0,0 +1,73 @@
+// Copyright (c) 2017-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+struct bo;
+
+struct BoMappingStats
+{
+	uint64_t maps = 0;      //bo_map calls
+	uint64_t hits = 0;      //of those served by an existing mapping
+	uint64_t evictions = 0; //idle mappings dropped for the address space cap
+	uint64_t failures = 0;  //bo_map calls refused by the cap or mmap
+	size_t mappedBytes = 0;
+	size_t idleBytes = 0;   //mapped without a user, evictable
+};
+
+//CPU mappings of dumb buffers, one per bo, shared by every bo_map caller and
+//counted. A mapping nobody uses stays until its bo is destroyed, or until
+//mapping another bo would exceed the address space cap. The cap guards
+//32-bit userlands, where a few dozen 1080p frames exhaust the VA space.
+class BoMappingCache
+{
+public:
+	static constexpr size_t DEFAULT_CAP = sizeof(void*) == 4 ? size_t(256) << 20 : size_t(-1);
+
+	static BoMappingCache& instance();
+
+	BoMappingCache(const BoMappingCache&) = delete;
+	BoMappingCache& operator=(const BoMappingCache&) = delete;
+
+	int map(struct bo *bo, void **out);
+	void unmap(struct bo *bo); //drops a reference, the mapping stays cached
+	void forget(struct bo *bo); //unmap now, the bo is being destroyed
+	void setCap(size_t bytes);
+	size_t cap();
+
+	BoMappingStats stats();
+	std::string summary();
+
+private:
+	BoMappingCache() {}
+
+	bool makeRoom(size_t bytes); //evict idle mappings, false if bytes still do not fit
+	void release(struct bo *bo);
+
+	std::mutex mMutex;
+	std::list<struct bo*> mIdle; //mapped without a user, least recently used last
+	std::unordered_map<struct bo*, std::list<struct bo*>::iterator> mIdleIndex;
+	size_t mCap = DEFAULT_CAP;
+	BoMappingStats mStats;
+};
@@ -0,0 +1,102 @@
+// Copyright (c) 2017-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+#include "modesetWorker.h"
+#include "logging.h"
+
+ModesetWorker::ModesetWorker()
+	:mContext(g_main_context_ref_thread_default())
+	,mThread(&ModesetWorker::run, this)
+{
+}
+
+ModesetWorker::~ModesetWorker()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStop = true;
+	}
+	mWake.notify_one();
+	mThread.join();
+
+	//Completions not delivered yet would run on a destroyed worker, drop them
+	if (mCompletedSource)
+	{
+		g_source_destroy(mCompletedSource);
+		g_source_unref(mCompletedSource);
+	}
+	g_main_context_unref(mContext);
+}
+
+void ModesetWorker::post(std::function<void()> work, std::function<void()> done)
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mPending.push_back(Job{work, done});
+	}
+	mWake.notify_one();
+}
+
+void ModesetWorker::run()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	while (true)
+	{
+		mWake.wait(lock, [this] { return mStop || !mPending.empty(); });
+		if (mStop)
+		{
+			break;
+		}
+		Job job = std::move(mPending.front());
+		mPending.pop_front();
+
+		lock.unlock();
+		if (job.work)
+		{
+			job.work();
+		}
+		lock.lock();
+
+		mCompleted.push_back(std::move(job));
+		if (!mCompletedSource)
+		{
+			mCompletedSource = g_idle_source_new();
+			g_source_set_callback(mCompletedSource, dispatchCompleted, this, nullptr);
+			g_source_attach(mCompletedSource, mContext);
+		}
+	}
+}
+
+gboolean ModesetWorker::dispatchCompleted(gpointer userData)
+{
+	ModesetWorker *worker = static_cast<ModesetWorker*>(userData);
+	std::deque<Job> completed;
+	{
+		std::lock_guard<std::mutex> lock(worker->mMutex);
+		completed.swap(worker->mCompleted);
+		g_source_unref(worker->mCompletedSource);
+		worker->mCompletedSource = nullptr;
+	}
+	for (auto &job : completed)
+	{
+		if (job.done)
+		{
+			job.done();
+		}
+	}
+	return G_SOURCE_REMOVE;
+}
@@ -0,0 +1,59 @@
+// Copyright (c) 2017-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <glib.h>
+
+//Runs blocking work, such as a modeset commit waiting for link training, on a
+//dedicated thread. Jobs run in the order they were posted. Each job's done
+//callback is invoked on the GMainContext the worker was created on.
+class ModesetWorker
+{
+public:
+	ModesetWorker();
+	~ModesetWorker();
+
+	ModesetWorker(const ModesetWorker&) = delete;
+	ModesetWorker& operator=(const ModesetWorker&) = delete;
+
+	void post(std::function<void()> work, std::function<void()> done);
+
+private:
+	struct Job
+	{
+		std::function<void()> work;
+		std::function<void()> done;
+	};
+
+	void run();
+	static gboolean dispatchCompleted(gpointer userData);
+
+	GMainContext *mContext;
+	std::mutex mMutex;
+	std::condition_variable mWake;
+	std::deque<Job> mPending;
+	std::deque<Job> mCompleted;
+	GSource *mCompletedSource = nullptr; //idle source draining mCompleted, at most one attached
+	bool mStop = false;
+	std::thread mThread;
+};
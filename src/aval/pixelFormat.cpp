@@ -0,0 +1,85 @@
+// Copyright (c) 2017-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+#include <string.h>
+
+#include "pixelFormat.h"
+
+namespace
+{
+
+//Open addressing over the fourccs, at most half full so probes stay short
+const unsigned int INDEX_SLOTS = 128;
+static_assert(FORMAT_INFO_COUNT <= INDEX_SLOTS / 2, "grow INDEX_SLOTS with format_info");
+
+unsigned int indexSlot(uint32_t format)
+{
+	return (format * 0xc1565be9u) >> 25;
+}
+
+struct FormatIndex
+{
+	signed char slots[INDEX_SLOTS];
+
+	FormatIndex()
+	{
+		memset(slots, -1, sizeof(slots));
+		for (size_t i = 0; i < FORMAT_INFO_COUNT; i++)
+		{
+			unsigned int slot = indexSlot(format_info[i].format);
+			while (slots[slot] >= 0)
+				slot = (slot + 1) % INDEX_SLOTS;
+			slots[slot] = i;
+		}
+	}
+};
+
+}
+
+const struct util_format_info *util_format_info_find(uint32_t format)
+{
+	static const FormatIndex index;
+
+	for (unsigned int slot = indexSlot(format); index.slots[slot] >= 0; slot = (slot + 1) % INDEX_SLOTS)
+	{
+		const struct util_format_info *info = &format_info[index.slots[slot]];
+		if (info->format == format)
+			return info;
+	}
+	return NULL;
+}
+
+uint32_t util_format_fourcc(const char *name)
+{
+	//format_info names are their fourcc spelled out
+	if (!name || strlen(name) != 4)
+		return 0;
+	uint32_t format = fourcc_code(name[0], name[1], name[2], name[3]);
+	return util_format_info_find(format) ? format : 0;
+}
+
+void util_format_layout(const struct util_format_info *info, unsigned int height, unsigned int pitch,
+                        unsigned int handle, unsigned int handles[4], unsigned int pitches[4],
+                        unsigned int offsets[4])
+{
+	for (unsigned int plane = 0; plane < info->planes; plane++)
+	{
+		handles[plane] = handle;
+		pitches[plane] = util_format_plane_pitch(*info, plane, pitch);
+		offsets[plane] = util_format_plane_offset(*info, plane, height, pitch);
+	}
+}
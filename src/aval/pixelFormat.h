@@ -0,0 +1,245 @@
+// Copyright (c) 2017-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+/*
+ * Copyright 2008 Tungsten Graphics
+ *   Jakob Bornecrantz <jakob@tungstengraphics.com>
+ * Copyright 2008 Intel Corporation
+ *   Jesse Barnes <jesse.barnes@intel.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <drm_fourcc.h>
+
+struct util_color_component {
+	unsigned int length;
+	unsigned int offset;
+};
+
+struct util_rgb_info {
+	struct util_color_component red;
+	struct util_color_component green;
+	struct util_color_component blue;
+	struct util_color_component alpha;
+};
+
+enum util_yuv_order {
+	YUV_YCbCr = 1,
+	YUV_YCrCb = 2,
+	YUV_YC = 4,
+	YUV_CY = 8,
+};
+
+struct util_yuv_info {
+	enum util_yuv_order order;
+	unsigned int xsub;
+	unsigned int ysub;
+	unsigned int chroma_stride; //chroma bytes per subsampled luma byte
+};
+
+//Everything allocation, fb creation and pattern fill need to know about a
+//format. All planes live in one dumb buffer allocated at bpp per pixel: the
+//luma plane at the buffer pitch and height, each chroma plane after it at
+//pitch * chroma_stride / xsub and height / ysub.
+struct util_format_info {
+	uint32_t format;
+	const char *name;    //the fourcc as a string
+	unsigned int planes;
+	unsigned int bpp;    //of the first plane
+	struct util_rgb_info rgb;
+	struct util_yuv_info yuv;
+};
+
+#define PIXEL_FORMAT_RGB(fourcc, name, bpp, rl, ro, gl, go, bl, bo, al, ao) \
+	{ (fourcc), (name), 1, (bpp), \
+	  { { (rl), (ro) }, { (gl), (go) }, { (bl), (bo) }, { (al), (ao) } }, \
+	  { (enum util_yuv_order)0, 1, 1, 0 } }
+
+#define PIXEL_FORMAT_YUV(fourcc, name, planes, bpp, order, xsub, ysub, chroma_stride) \
+	{ (fourcc), (name), (planes), (bpp), \
+	  { { 0, 0 }, { 0, 0 }, { 0, 0 }, { 0, 0 } }, \
+	  { (enum util_yuv_order)(order), (xsub), (ysub), (chroma_stride) } }
+
+//Adding a format is one line here, the static_asserts below check it
+constexpr struct util_format_info format_info[] = {
+	/* YUV packed */
+	PIXEL_FORMAT_YUV(DRM_FORMAT_UYVY, "UYVY", 1, 16, YUV_YCbCr | YUV_CY, 2, 2, 2),
+	PIXEL_FORMAT_YUV(DRM_FORMAT_VYUY, "VYUY", 1, 16, YUV_YCrCb | YUV_CY, 2, 2, 2),
+	PIXEL_FORMAT_YUV(DRM_FORMAT_YUYV, "YUYV", 1, 16, YUV_YCbCr | YUV_YC, 2, 2, 2),
+	PIXEL_FORMAT_YUV(DRM_FORMAT_YVYU, "YVYU", 1, 16, YUV_YCrCb | YUV_YC, 2, 2, 2),
+	/* YUV semi-planar */
+	PIXEL_FORMAT_YUV(DRM_FORMAT_NV12, "NV12", 2, 8, YUV_YCbCr, 2, 2, 2),
+	PIXEL_FORMAT_YUV(DRM_FORMAT_NV21, "NV21", 2, 8, YUV_YCrCb, 2, 2, 2),
+	PIXEL_FORMAT_YUV(DRM_FORMAT_NV16, "NV16", 2, 8, YUV_YCbCr, 2, 1, 2),
+	PIXEL_FORMAT_YUV(DRM_FORMAT_NV61, "NV61", 2, 8, YUV_YCrCb, 2, 1, 2),
+	/* YUV planar */
+	PIXEL_FORMAT_YUV(DRM_FORMAT_YUV420, "YU12", 3, 8, YUV_YCbCr, 2, 2, 1),
+	PIXEL_FORMAT_YUV(DRM_FORMAT_YVU420, "YV12", 3, 8, YUV_YCrCb, 2, 2, 1),
+	/* RGB16 */
+	PIXEL_FORMAT_RGB(DRM_FORMAT_ARGB4444, "AR12", 16, 4, 8, 4, 4, 4, 0, 4, 12),
+	PIXEL_FORMAT_RGB(DRM_FORMAT_XRGB4444, "XR12", 16, 4, 8, 4, 4, 4, 0, 0, 0),
+	PIXEL_FORMAT_RGB(DRM_FORMAT_ABGR4444, "AB12", 16, 4, 0, 4, 4, 4, 8, 4, 12),
+	PIXEL_FORMAT_RGB(DRM_FORMAT_XBGR4444, "XB12", 16, 4, 0, 4, 4, 4, 8, 0, 0),
+	PIXEL_FORMAT_RGB(DRM_FORMAT_RGBA4444, "RA12", 16, 4, 12, 4, 8, 4, 4, 4, 0),
+	PIXEL_FORMAT_RGB(DRM_FORMAT_RGBX4444, "RX12", 16, 4, 12, 4, 8, 4, 4, 0, 0),
+	PIXEL_FORMAT_RGB(DRM_FORMAT_BGRA4444, "BA12", 16, 4, 4, 4, 8, 4, 12, 4, 0),
+	PIXEL_FORMAT_RGB(DRM_FORMAT_BGRX4444, "BX12", 16, 4, 4, 4, 8, 4, 12, 0, 0),
+	PIXEL_FORMAT_RGB(DRM_FORMAT_ARGB1555, "AR15", 16, 5, 10, 5, 5, 5, 0, 1, 15),
+	PIXEL_FORMAT_RGB(DRM_FORMAT_XRGB1555, "XR15", 16, 5, 10, 5, 5, 5, 0, 0, 0),
+	PIXEL_FORMAT_RGB(DRM_FORMAT_ABGR1555, "AB15", 16, 5, 0, 5, 5, 5, 10, 1, 15),
+	PIXEL_FORMAT_RGB(DRM_FORMAT_XBGR1555, "XB15", 16, 5, 0, 5, 5, 5, 10, 0, 0),
+	PIXEL_FORMAT_RGB(DRM_FORMAT_RGBA5551, "RA15", 16, 5, 11, 5, 6, 5, 1, 1, 0),
+	PIXEL_FORMAT_RGB(DRM_FORMAT_RGBX5551, "RX15", 16, 5, 11, 5, 6, 5, 1, 0, 0),
+	PIXEL_FORMAT_RGB(DRM_FORMAT_BGRA5551, "BA15", 16, 5, 1, 5, 6, 5, 11, 1, 0),
+	PIXEL_FORMAT_RGB(DRM_FORMAT_BGRX5551, "BX15", 16, 5, 1, 5, 6, 5, 11, 0, 0),
+	PIXEL_FORMAT_RGB(DRM_FORMAT_RGB565, "RG16", 16, 5, 11, 6, 5, 5, 0, 0, 0),
+	PIXEL_FORMAT_RGB(DRM_FORMAT_BGR565, "BG16", 16, 5, 0, 6, 5, 5, 11, 0, 0),
+	/* RGB24 */
+	PIXEL_FORMAT_RGB(DRM_FORMAT_BGR888, "BG24", 24, 8, 0, 8, 8, 8, 16, 0, 0),
+	PIXEL_FORMAT_RGB(DRM_FORMAT_RGB888, "RG24", 24, 8, 16, 8, 8, 8, 0, 0, 0),
+	/* RGB32 */
+	PIXEL_FORMAT_RGB(DRM_FORMAT_ARGB8888, "AR24", 32, 8, 16, 8, 8, 8, 0, 8, 24),
+	PIXEL_FORMAT_RGB(DRM_FORMAT_XRGB8888, "XR24", 32, 8, 16, 8, 8, 8, 0, 0, 0),
+	PIXEL_FORMAT_RGB(DRM_FORMAT_ABGR8888, "AB24", 32, 8, 0, 8, 8, 8, 16, 8, 24),
+	PIXEL_FORMAT_RGB(DRM_FORMAT_XBGR8888, "XB24", 32, 8, 0, 8, 8, 8, 16, 0, 0),
+	PIXEL_FORMAT_RGB(DRM_FORMAT_RGBA8888, "RA24", 32, 8, 24, 8, 16, 8, 8, 8, 0),
+	PIXEL_FORMAT_RGB(DRM_FORMAT_RGBX8888, "RX24", 32, 8, 24, 8, 16, 8, 8, 0, 0),
+	PIXEL_FORMAT_RGB(DRM_FORMAT_BGRA8888, "BA24", 32, 8, 8, 8, 16, 8, 24, 8, 0),
+	PIXEL_FORMAT_RGB(DRM_FORMAT_BGRX8888, "BX24", 32, 8, 8, 8, 16, 8, 24, 0, 0),
+	PIXEL_FORMAT_RGB(DRM_FORMAT_ARGB2101010, "AR30", 32, 10, 20, 10, 10, 10, 0, 2, 30),
+	PIXEL_FORMAT_RGB(DRM_FORMAT_XRGB2101010, "XR30", 32, 10, 20, 10, 10, 10, 0, 0, 0),
+	PIXEL_FORMAT_RGB(DRM_FORMAT_ABGR2101010, "AB30", 32, 10, 0, 10, 10, 10, 20, 2, 30),
+	PIXEL_FORMAT_RGB(DRM_FORMAT_XBGR2101010, "XB30", 32, 10, 0, 10, 10, 10, 20, 0, 0),
+	PIXEL_FORMAT_RGB(DRM_FORMAT_RGBA1010102, "RA30", 32, 10, 22, 10, 12, 10, 2, 2, 0),
+	PIXEL_FORMAT_RGB(DRM_FORMAT_RGBX1010102, "RX30", 32, 10, 22, 10, 12, 10, 2, 0, 0),
+	PIXEL_FORMAT_RGB(DRM_FORMAT_BGRA1010102, "BA30", 32, 10, 2, 10, 12, 10, 22, 2, 0),
+	PIXEL_FORMAT_RGB(DRM_FORMAT_BGRX1010102, "BX30", 32, 10, 2, 10, 12, 10, 22, 0, 0),
+};
+
+constexpr size_t FORMAT_INFO_COUNT = sizeof(format_info) / sizeof(format_info[0]);
+
+//O(1) lookup by fourcc, NULL for formats missing from format_info. Each
+//translation unit has its own copy of the table, compare formats, not pointers.
+const struct util_format_info *util_format_info_find(uint32_t format);
+//The fourcc named by a format_info name such as "NV12", 0 if unknown
+uint32_t util_format_fourcc(const char *name);
+
+//Index of a format in format_info, FORMAT_INFO_COUNT if it is missing. This
+//is a linear scan meant for static_asserts, use util_format_info_find at runtime.
+constexpr size_t util_format_index(uint32_t format, size_t i = 0)
+{
+	return i == FORMAT_INFO_COUNT || format_info[i].format == format ? i : util_format_index(format, i + 1);
+}
+
+//Rows the dumb buffer needs for all planes at this luma height
+constexpr unsigned int util_format_virtual_height(const struct util_format_info &info, unsigned int height)
+{
+	return height + (info.planes - 1) * (height / info.yuv.ysub) * info.yuv.chroma_stride / info.yuv.xsub;
+}
+
+constexpr unsigned int util_format_plane_pitch(const struct util_format_info &info, unsigned int plane,
+                                               unsigned int pitch)
+{
+	return plane ? pitch * info.yuv.chroma_stride / info.yuv.xsub : pitch;
+}
+
+constexpr unsigned int util_format_plane_rows(const struct util_format_info &info, unsigned int plane,
+                                              unsigned int height)
+{
+	return plane ? height / info.yuv.ysub : height;
+}
+
+//Byte offset of a plane in the buffer, of the end of the last plane for plane == planes
+constexpr unsigned int util_format_plane_offset(const struct util_format_info &info, unsigned int plane,
+                                                unsigned int height, unsigned int pitch)
+{
+	return plane ? util_format_plane_offset(info, plane - 1, height, pitch) +
+	               util_format_plane_pitch(info, plane - 1, pitch) * util_format_plane_rows(info, plane - 1, height)
+	             : 0;
+}
+
+//Fill the drmModeAddFB2 arrays for a buffer of this format, every plane in the one handle
+void util_format_layout(const struct util_format_info *info, unsigned int height, unsigned int pitch,
+                        unsigned int handle, unsigned int handles[4], unsigned int pitches[4],
+                        unsigned int offsets[4]);
+
+/* -----------------------------------------------------------------------------
+ * Compile time checks of format_info
+ */
+
+constexpr bool util_format_name_matches(const struct util_format_info &info)
+{
+	return info.name[0] == (char)(info.format & 0xff) && info.name[1] == (char)((info.format >> 8) & 0xff) &&
+	       info.name[2] == (char)((info.format >> 16) & 0xff) && info.name[3] == (char)(info.format >> 24) &&
+	       info.name[4] == '\0';
+}
+
+constexpr bool util_format_component_fits(const struct util_color_component &c, unsigned int bpp)
+{
+	return c.offset + c.length <= bpp;
+}
+
+constexpr bool util_format_well_formed(const struct util_format_info &info)
+{
+	return util_format_name_matches(info) && info.planes >= 1 && info.planes <= 3 && info.bpp && info.bpp % 8 == 0 &&
+	       info.yuv.xsub && info.yuv.ysub && (info.planes == 1 || (info.bpp == 8 && info.yuv.chroma_stride)) &&
+	       util_format_component_fits(info.rgb.red, info.bpp) && util_format_component_fits(info.rgb.green, info.bpp) &&
+	       util_format_component_fits(info.rgb.blue, info.bpp) && util_format_component_fits(info.rgb.alpha, info.bpp);
+}
+
+//The planes exactly fill the rows allocated for them, checked at 1080p
+constexpr bool util_format_layout_fits(const struct util_format_info &info)
+{
+	return util_format_plane_offset(info, info.planes, 1080, 1920 * info.bpp / 8) ==
+	       util_format_virtual_height(info, 1080) * (1920 * info.bpp / 8);
+}
+
+constexpr bool util_format_table_valid(size_t i = 0)
+{
+	return i == FORMAT_INFO_COUNT || (util_format_well_formed(format_info[i]) && util_format_layout_fits(format_info[i]) &&
+	                                  util_format_index(format_info[i].format) == i && util_format_table_valid(i + 1));
+}
+
+static_assert(util_format_table_valid(), "format_info: bad descriptor, layout or duplicate fourcc");
+
+static_assert(util_format_virtual_height(format_info[util_format_index(DRM_FORMAT_NV12)], 1080) == 1620,
+              "NV12 needs half a frame of interleaved chroma rows");
+static_assert(util_format_plane_offset(format_info[util_format_index(DRM_FORMAT_YUV420)], 2, 1080, 1920) ==
+              1920 * 1080 * 5 / 4, "YUV420 V plane follows a quarter size U plane");
+static_assert(util_format_plane_pitch(format_info[util_format_index(DRM_FORMAT_YUV420)], 1, 1920) == 960,
+              "YUV420 chroma planes have half the luma pitch");
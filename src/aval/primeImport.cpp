@@ -0,0 +1,135 @@
+// Copyright (c) 2017-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+#include <cerrno>
+#include <cstring>
+#include <sys/ioctl.h>
+#include <xf86drm.h>
+#include <xf86drmMode.h>
+#include "primeImport.h"
+#include "buffers.h"
+#include "pixelFormat.h"
+#include "logging.h"
+
+void PrimeImporter::probe(int fd)
+{
+	uint64_t value = 0;
+	if (!drmGetCap(fd, DRM_CAP_PRIME, &value))
+	{
+		mImport = value & DRM_PRIME_CAP_IMPORT;
+		mExport = value & DRM_PRIME_CAP_EXPORT;
+	}
+	value = 0;
+	mModifiers = !drmGetCap(fd, DRM_CAP_ADDFB2_MODIFIERS, &value) && value;
+	LOG_DEBUG("PRIME import %d export %d, fb modifiers %d", mImport, mExport, mModifiers);
+}
+
+int PrimeImporter::import(int fd, const DmabufFrame &frame, uint32_t &fbId)
+{
+	if (!mImport)
+	{
+		return -EOPNOTSUPP;
+	}
+	if (!frame.planes || frame.planes > 4)
+	{
+		return -EINVAL;
+	}
+	//Compressed modifiers may add aux planes, plain layouts must match format_info
+	const struct util_format_info *info = util_format_info_find(frame.format);
+	if (info && frame.planes != info->planes &&
+	    (frame.modifier == DRM_FORMAT_MOD_INVALID || frame.modifier == DRM_FORMAT_MOD_LINEAR))
+	{
+		LOG_ERROR(MSGID_FB_CREATION_FAILED, 0, "dma-buf of %s has %u planes, expected %u",
+		          info->name, frame.planes, info->planes);
+		return -EINVAL;
+	}
+	if (frame.modifier != DRM_FORMAT_MOD_INVALID && !mModifiers)
+	{
+		LOG_ERROR(MSGID_FB_CREATION_FAILED, 0, "Device takes no fb modifiers, dma-buf with 0x%llx rejected",
+		          static_cast<unsigned long long>(frame.modifier));
+		return -EOPNOTSUPP;
+	}
+
+	uint32_t handles[4] = {0, 0, 0, 0};
+	uint64_t modifiers[4] = {0, 0, 0, 0};
+	int ret = 0;
+	for (uint32_t i = 0; i < frame.planes && !ret; i++)
+	{
+		//Planes in the same dma-buf resolve to the same handle
+		ret = drmPrimeFDToHandle(fd, frame.fds[i], &handles[i]);
+		if (ret)
+		{
+			ret = -errno;
+			LOG_ERROR(MSGID_FB_CREATION_FAILED, 0, "Failed to import dma-buf %d: %s", frame.fds[i], strerror(errno));
+		}
+		modifiers[i] = frame.modifier;
+	}
+	if (!ret)
+	{
+		ret = frame.modifier != DRM_FORMAT_MOD_INVALID ?
+		      drmModeAddFB2WithModifiers(fd, frame.width, frame.height, frame.format, handles, frame.pitches,
+		                                 frame.offsets, modifiers, &fbId, DRM_MODE_FB_MODIFIERS) :
+		      drmModeAddFB2(fd, frame.width, frame.height, frame.format, handles, frame.pitches,
+		                    frame.offsets, &fbId, 0);
+		if (ret)
+		{
+			ret = -errno;
+			LOG_ERROR(MSGID_FB_CREATION_FAILED, 0, "Failed to add fb for %ux%u dma-buf: %s", frame.width,
+			          frame.height, strerror(errno));
+		}
+	}
+
+	//The fb holds its own references. A dma-buf exported by this device resolves
+	//to the handle of the exporting bo, which must stay open.
+	for (uint32_t i = 0; i < frame.planes; i++)
+	{
+		bool seen = false;
+		for (uint32_t j = 0; j < i; j++)
+		{
+			seen |= handles[j] == handles[i];
+		}
+		if (handles[i] && !seen && !bo_owns_handle(fd, handles[i]))
+		{
+			struct drm_gem_close close;
+			memset(&close, 0, sizeof(close));
+			close.handle = handles[i];
+			drmIoctl(fd, DRM_IOCTL_GEM_CLOSE, &close);
+		}
+	}
+	if (!ret)
+	{
+		mFbs.insert(fbId);
+	}
+	return ret;
+}
+
+void PrimeImporter::release(int fd, uint32_t fbId)
+{
+	if (mFbs.erase(fbId))
+	{
+		drmModeRmFB(fd, fbId);
+	}
+}
+
+void PrimeImporter::clear(int fd)
+{
+	for (auto fbId : mFbs)
+	{
+		drmModeRmFB(fd, fbId);
+	}
+	mFbs.clear();
+}
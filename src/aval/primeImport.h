@@ -0,0 +1,64 @@
+// Copyright (c) 2017-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <drm.h>
+#include <drm_fourcc.h>
+
+//A frame in dma-bufs, e.g. from a V4L2 decoder, a CMA allocator or another
+//DRM device. Planes may share an fd. The fds stay owned by the caller.
+struct DmabufFrame
+{
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t format = 0; //DRM fourcc
+	uint64_t modifier = DRM_FORMAT_MOD_INVALID; //implicit, driver chosen layout
+	uint32_t planes = 1;
+	int fds[4] = {-1, -1, -1, -1};
+	uint32_t pitches[4] = {0, 0, 0, 0};
+	uint32_t offsets[4] = {0, 0, 0, 0};
+};
+
+//Turns dma-bufs into fbs of one device with drmPrimeFDToHandle and
+//drmModeAddFB2, so they can be scanned out without a copy. The fb keeps the
+//buffer alive, the GEM handles are closed right after the fb is created.
+class PrimeImporter
+{
+public:
+	PrimeImporter() {}
+	PrimeImporter(const PrimeImporter&) = delete;
+	PrimeImporter& operator=(const PrimeImporter&) = delete;
+
+	void probe(int fd); //reads the PRIME and modifier capabilities of the device
+	bool canImport() const { return mImport; }
+	bool canExport() const { return mExport; }
+
+	int import(int fd, const DmabufFrame &frame, uint32_t &fbId);
+	void release(int fd, uint32_t fbId);
+	void clear(int fd); //remove every imported fb, before the device is closed
+	size_t imported() const { return mFbs.size(); }
+
+private:
+	bool mImport = false;
+	bool mExport = false;
+	bool mModifiers = false;
+	std::set<uint32_t> mFbs;
+};
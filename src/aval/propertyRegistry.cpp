@@ -0,0 +1,155 @@
+// Copyright (c) 2017-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <cstring>
+#include <xf86drm.h>
+#include <xf86drmMode.h>
+#include "propertyRegistry.h"
+#include "logging.h"
+
+static const char* const DRM_PROP_NAMES[DRM_PROP_COUNT] = {
+		"FB_ID",
+		"CRTC_ID",
+		"SRC_X",
+		"SRC_Y",
+		"SRC_W",
+		"SRC_H",
+		"CRTC_X",
+		"CRTC_Y",
+		"CRTC_W",
+		"CRTC_H",
+		"zpos",
+		"alpha",
+		"rotation",
+		"IN_FENCE_FD",
+		"FB_DAMAGE_CLIPS",
+		"IN_FORMATS",
+		"type",
+		"MODE_ID",
+		"ACTIVE",
+		"OUT_FENCE_PTR",
+		"EDID",
+		"DPMS",
+};
+
+static const std::unordered_map<std::string, DRM_PROP_T>& propertyNameIndex()
+{
+	//Cards load on parallel threads, a function static is initialized exactly once
+	static const auto index = []
+	{
+		std::unordered_map<std::string, DRM_PROP_T> names;
+		for (int i = 0; i < DRM_PROP_COUNT; i++)
+		{
+			names.emplace(DRM_PROP_NAMES[i], static_cast<DRM_PROP_T>(i));
+		}
+		return names;
+	}();
+	return index;
+}
+
+const char* DrmPropertyRegistry::name(DRM_PROP_T prop)
+{
+	return prop < DRM_PROP_COUNT ? DRM_PROP_NAMES[prop] : "";
+}
+
+bool DrmPropertyRegistry::lookup(const std::string &name, DRM_PROP_T &prop)
+{
+	auto &index = propertyNameIndex();
+	auto it = index.find(name);
+	if (it == index.end())
+	{
+		return false;
+	}
+	prop = it->second;
+	return true;
+}
+
+void DrmPropertyRegistry::load(int fd, uint32_t objectId, uint32_t objectType)
+{
+	drmModeObjectPropertiesPtr props = drmModeObjectGetProperties(fd, objectId, objectType);
+	if (!props)
+	{
+		LOG_ERROR(MSGID_DEVICE_ERROR, 0, "Failed to get properties of object %u: %s", objectId, strerror(errno));
+		return;
+	}
+
+	size_t index;
+	auto existing = mSlotIndex.find(objectId);
+	if (existing != mSlotIndex.end())
+	{
+		index = existing->second;
+	}
+	else
+	{
+		index = mSlots.size();
+		mSlots.emplace_back();
+		mSlotIndex.emplace(objectId, index);
+	}
+	Slot &slot = mSlots[index];
+	memset(&slot, 0, sizeof(slot));
+
+	for (uint32_t i = 0; i < props->count_props; i++)
+	{
+		drmModePropertyPtr prop = drmModeGetProperty(fd, props->props[i]);
+		if (!prop)
+		{
+			continue;
+		}
+		DRM_PROP_T known;
+		if (lookup(prop->name, known))
+		{
+			slot.ids[known] = prop->prop_id;
+			slot.values[known] = props->prop_values[i];
+		}
+		drmModeFreeProperty(prop);
+	}
+	drmModeFreeObjectProperties(props);
+}
+
+void DrmPropertyRegistry::clear()
+{
+	mSlots.clear();
+	mSlotIndex.clear();
+}
+
+const DrmPropertyRegistry::Slot* DrmPropertyRegistry::find(uint32_t objectId) const
+{
+	auto it = mSlotIndex.find(objectId);
+	return it == mSlotIndex.end() ? nullptr : &mSlots[it->second];
+}
+
+uint32_t DrmPropertyRegistry::id(uint32_t objectId, DRM_PROP_T prop) const
+{
+	const Slot *slot = find(objectId);
+	return (slot && prop < DRM_PROP_COUNT) ? slot->ids[prop] : 0;
+}
+
+uint32_t DrmPropertyRegistry::id(uint32_t objectId, const std::string &name) const
+{
+	DRM_PROP_T prop;
+	return lookup(name, prop) ? id(objectId, prop) : 0;
+}
+
+bool DrmPropertyRegistry::value(uint32_t objectId, DRM_PROP_T prop, uint64_t &value) const
+{
+	const Slot *slot = find(objectId);
+	if (!slot || prop >= DRM_PROP_COUNT || !slot->ids[prop])
+	{
+		return false;
+	}
+	value = slot->values[prop];
+	return true;
+}
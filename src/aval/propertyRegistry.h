@@ -0,0 +1,84 @@
+// Copyright (c) 2017-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//Properties the library knows by name. Add new entries before DRM_PROP_COUNT
+//and give them a kernel name in propertyRegistry.cpp.
+typedef enum
+{
+	DRM_PROP_FB_ID = 0,
+	DRM_PROP_CRTC_ID,
+	DRM_PROP_SRC_X,
+	DRM_PROP_SRC_Y,
+	DRM_PROP_SRC_W,
+	DRM_PROP_SRC_H,
+	DRM_PROP_CRTC_X,
+	DRM_PROP_CRTC_Y,
+	DRM_PROP_CRTC_W,
+	DRM_PROP_CRTC_H,
+	DRM_PROP_ZPOS,
+	DRM_PROP_ALPHA,
+	DRM_PROP_ROTATION,
+	DRM_PROP_IN_FENCE_FD,
+	DRM_PROP_FB_DAMAGE_CLIPS,
+	DRM_PROP_IN_FORMATS,
+	DRM_PROP_TYPE,
+	DRM_PROP_MODE_ID,
+	DRM_PROP_ACTIVE,
+	DRM_PROP_OUT_FENCE_PTR,
+	DRM_PROP_EDID,
+	DRM_PROP_DPMS,
+	DRM_PROP_COUNT
+} DRM_PROP_T;
+
+//Name to id table for plane, crtc and connector properties of one device.
+//Built once when the device is loaded, connectors are refreshed on hotplug.
+//Object ids are unique per device, so (object, property) resolves with one
+//hash lookup for the object slot and one array index for the property.
+class DrmPropertyRegistry
+{
+public:
+	void load(int fd, uint32_t objectId, uint32_t objectType);
+	void clear();
+
+	uint32_t id(uint32_t objectId, DRM_PROP_T prop) const;
+	uint32_t id(uint32_t objectId, const std::string &name) const;
+	bool has(uint32_t objectId, DRM_PROP_T prop) const { return id(objectId, prop) != 0; }
+	//Value read when the object was (re)loaded. Only reliable for immutable
+	//properties and for connector properties right after a hotplug refresh.
+	bool value(uint32_t objectId, DRM_PROP_T prop, uint64_t &value) const;
+
+	static const char* name(DRM_PROP_T prop);
+	static bool lookup(const std::string &name, DRM_PROP_T &prop);
+
+private:
+	struct Slot
+	{
+		uint32_t ids[DRM_PROP_COUNT];
+		uint64_t values[DRM_PROP_COUNT];
+	};
+
+	const Slot* find(uint32_t objectId) const;
+
+	std::vector<Slot> mSlots;
+	std::unordered_map<uint32_t, size_t> mSlotIndex; //object id -> mSlots index
+};
@@ -0,0 +1,121 @@
+// Copyright (c) 2017-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+#include <cerrno>
+#include <cstring>
+#include <xf86drm.h>
+#include <xf86drmMode.h>
+#include "scanoutFbCache.h"
+#include "buffers.h"
+#include "logging.h"
+
+int ScanoutFbCache::acquire(int fd, uint32_t width, uint32_t height, uint32_t format, ScanoutBuffer &buf)
+{
+	for (auto idle = mIdle.begin(); idle != mIdle.end(); ++idle)
+	{
+		if (idle->width == width && idle->height == height && idle->format == format)
+		{
+			buf = *idle;
+			mIdleBytes -= idle->size;
+			mIdle.erase(idle);
+			mHits++;
+			return 0;
+		}
+	}
+	mMisses++;
+
+	uint32_t handles[4] = {0}, pitches[4] = {0}, offsets[4] = {0};
+	unsigned int fb_id;
+
+	struct bo* bo = bo_create(fd, format, width, height, handles, pitches, offsets);
+	if (!bo)
+	{
+		int err = errno;
+		LOG_ERROR(MSGID_BUFFER_CREATION_FAILED, 0, "failed to create frame buffers (%ux%u): %s", width, height, strerror(err));
+		return -err;
+	}
+
+	int ret = drmModeAddFB2(fd, width, height, format, handles, pitches, offsets, &fb_id, 0);
+	if (ret) {
+		LOG_ERROR(MSGID_FB_CREATION_FAILED, 0, "failed to add fb (%ux%u): %s\n", width, height, strerror(errno));
+		bo_destroy(bo);
+		return ret;
+	}
+
+	buf.bo = bo;
+	buf.fbId = fb_id;
+	buf.width = width;
+	buf.height = height;
+	buf.format = format;
+	buf.size = bo->size;
+	return 0;
+}
+
+void ScanoutFbCache::release(int fd, ScanoutBuffer &buf)
+{
+	if (!buf.fbId)
+	{
+		return;
+	}
+	mIdle.push_front(buf);
+	mIdleBytes += buf.size;
+	buf = ScanoutBuffer();
+	trim(fd);
+}
+
+void ScanoutFbCache::setBudget(int fd, size_t bytes)
+{
+	mBudget = bytes;
+	trim(fd);
+}
+
+void ScanoutFbCache::clear(int fd)
+{
+	for (auto &idle : mIdle)
+	{
+		destroy(fd, idle);
+	}
+	mIdle.clear();
+	mIdleBytes = 0;
+}
+
+void ScanoutFbCache::trim(int fd)
+{
+	while (mIdleBytes > mBudget && !mIdle.empty())
+	{
+		ScanoutBuffer &oldest = mIdle.back();
+		LOG_DEBUG("Evicting %ux%u scanout fb %u from cache", oldest.width, oldest.height, oldest.fbId);
+		mIdleBytes -= oldest.size;
+		destroy(fd, oldest);
+		mIdle.pop_back();
+		mEvictions++;
+	}
+}
+
+void ScanoutFbCache::destroy(int fd, ScanoutBuffer &buf)
+{
+	if (buf.fbId)
+	{
+		drmModeRmFB(fd, buf.fbId);
+	}
+	//Evicted for the scanout budget, so not parked in the dumb buffer pool either
+	if (buf.bo)
+	{
+		bo_destroy_dumb(buf.bo);
+	}
+	buf = ScanoutBuffer();
+}
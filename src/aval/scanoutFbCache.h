@@ -0,0 +1,74 @@
+// Copyright (c) 2017-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <list>
+
+struct bo;
+
+//One dumb buffer and its fb, scanned out by a crtc
+struct ScanoutBuffer
+{
+	struct bo *bo = nullptr;
+	uint32_t fbId = 0;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t format = 0;
+	size_t size = 0;
+};
+
+//Keeps scanout buffers released by a mode change for reuse, so toggling
+//between recent resolutions neither allocates nor calls drmModeAddFB2.
+//Idle buffers are evicted least recently released first once their total
+//size exceeds the budget. Buffers in use by a crtc do not count.
+class ScanoutFbCache
+{
+public:
+	static constexpr size_t DEFAULT_BUDGET = 32 << 20; //a 1080p and a 720p XRGB pair
+
+	ScanoutFbCache() {}
+	ScanoutFbCache(const ScanoutFbCache&) = delete;
+	ScanoutFbCache& operator=(const ScanoutFbCache&) = delete;
+
+	//Hand out an idle buffer of this size and format, or allocate one
+	int acquire(int fd, uint32_t width, uint32_t height, uint32_t format, ScanoutBuffer &buf);
+	//Return a buffer to the cache, it may be destroyed right away if over budget
+	void release(int fd, ScanoutBuffer &buf);
+	void setBudget(int fd, size_t bytes);
+	void clear(int fd);
+
+	size_t budget() const { return mBudget; }
+	size_t idleBytes() const { return mIdleBytes; }
+	uint64_t hits() const { return mHits; }
+	uint64_t misses() const { return mMisses; }
+	uint64_t evictions() const { return mEvictions; }
+
+	static void destroy(int fd, ScanoutBuffer &buf);
+
+private:
+	void trim(int fd);
+
+	std::list<ScanoutBuffer> mIdle; //most recently released first, a handful of entries at most
+	size_t mBudget = DEFAULT_BUDGET;
+	size_t mIdleBytes = 0;
+	uint64_t mHits = 0;
+	uint64_t mMisses = 0;
+	uint64_t mEvictions = 0;
+};
@@ -0,0 +1,180 @@
+// Copyright (c) 2017-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+#include <ctime>
+#include <cinttypes>
+#include <sstream>
+#include "scanoutLatency.h"
+#include "logging.h"
+
+void LatencyHistogram::record(uint64_t us)
+{
+	unsigned bucket = 0;
+	for (uint64_t v = us; v > 1 && bucket < BUCKETS - 1; v >>= 1)
+	{
+		bucket++;
+	}
+	buckets[bucket]++;
+	count++;
+	sumUs += us;
+	if (us > maxUs)
+	{
+		maxUs = us;
+	}
+}
+
+uint64_t LatencyHistogram::percentileUs(unsigned percent) const
+{
+	if (!count)
+	{
+		return 0;
+	}
+	uint64_t rank = (count * percent + 99) / 100;
+	uint64_t seen = 0;
+	for (unsigned i = 0; i < BUCKETS; i++)
+	{
+		seen += buckets[i];
+		if (seen >= rank)
+		{
+			return i == BUCKETS - 1 ? maxUs : (uint64_t(2) << i);
+		}
+	}
+	return maxUs;
+}
+
+void ScanoutSubmission::complete(unsigned int sequence, unsigned int tvSec, unsigned int tvUsec)
+{
+	if (tracker)
+	{
+		tracker->record(*this, sequence, tvSec, tvUsec);
+	}
+	*this = ScanoutSubmission();
+}
+
+uint64_t ScanoutLatencyTracker::now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return uint64_t(ts.tv_sec) * 1000000 + uint64_t(ts.tv_nsec) / 1000;
+}
+
+const char* ScanoutLatencyTracker::opName(SCANOUT_OP_T op)
+{
+	switch (op)
+	{
+		case SCANOUT_OP_MODESET: return "modeset";
+		case SCANOUT_OP_PLANE_UPDATE: return "plane update";
+		case SCANOUT_OP_PAGE_FLIP: return "page flip";
+		default: return "unknown";
+	}
+}
+
+ScanoutSubmission ScanoutLatencyTracker::submit(int fd, uint32_t crtcIndex, uint32_t crtcId, SCANOUT_OP_T op)
+{
+	ScanoutSubmission submission;
+	submission.tracker = this;
+	submission.op = op;
+	submission.crtcId = crtcId;
+	submission.submitUs = now();
+	uint32_t sequence = 0;
+	if (fd >= 0 && !queryVblank(fd, crtcIndex, sequence))
+	{
+		submission.targetSeq = sequence + 1;
+		submission.seqKnown = true;
+	}
+	return submission;
+}
+
+void ScanoutLatencyTracker::completeOnVblank(int fd, uint32_t crtcIndex, const ScanoutSubmission &submission)
+{
+	if (!submission.active())
+	{
+		return;
+	}
+	mWaiters.emplace_back();
+	VblankWaiter &waiter = mWaiters.back();
+	waiter.submission = submission;
+	if (requestVblankEvent(fd, crtcIndex, &waiter))
+	{
+		//crtc is off, the commit never reaches the screen on its own
+		mWaiters.pop_back();
+	}
+}
+
+void ScanoutLatencyTracker::VblankWaiter::onVblank(unsigned int sequence, unsigned int tvSec, unsigned int tvUsec)
+{
+	ScanoutLatencyTracker *owner = submission.tracker;
+	submission.complete(sequence, tvSec, tvUsec);
+	if (owner)
+	{
+		owner->mWaiters.remove_if([this](const VblankWaiter &w) { return &w == this; });
+	}
+}
+
+void ScanoutLatencyTracker::record(const ScanoutSubmission &submission, unsigned int sequence,
+                                   unsigned int tvSec, unsigned int tvUsec)
+{
+	uint64_t eventUs = uint64_t(tvSec) * 1000000 + tvUsec;
+	uint64_t latency = eventUs > submission.submitUs ? eventUs - submission.submitUs : 0;
+	mHistograms[submission.op].record(latency);
+
+	//A modeset may restart the vblank counter, only later commits can miss a frame
+	if (submission.seqKnown && submission.op != SCANOUT_OP_MODESET)
+	{
+		int32_t late = static_cast<int32_t>(sequence - submission.targetSeq);
+		if (late > 0)
+		{
+			mMissed[submission.crtcId] += late;
+			mMissedTotal += late;
+			LOG_DEBUG("%s on crtc %u missed %d vblank(s)", opName(submission.op), submission.crtcId, late);
+		}
+	}
+}
+
+uint64_t ScanoutLatencyTracker::missedVblanks(uint32_t crtcId) const
+{
+	auto missed = mMissed.find(crtcId);
+	return missed == mMissed.end() ? 0 : missed->second;
+}
+
+std::string ScanoutLatencyTracker::summary() const
+{
+	std::stringstream ss;
+	for (int op = 0; op < SCANOUT_OP_COUNT; op++)
+	{
+		const LatencyHistogram &h = mHistograms[op];
+		ss << opName(static_cast<SCANOUT_OP_T>(op)) << ": n=" << h.count
+		   << " mean=" << h.meanUs() << "us p50<=" << h.percentileUs(50)
+		   << "us p99<=" << h.percentileUs(99) << "us max=" << h.maxUs << "us\n";
+	}
+	ss << "missed vblanks: " << mMissedTotal;
+	for (auto &missed : mMissed)
+	{
+		ss << " crtc " << missed.first << "=" << missed.second;
+	}
+	return ss.str();
+}
+
+void ScanoutLatencyTracker::reset()
+{
+	for (auto &h : mHistograms)
+	{
+		h = LatencyHistogram();
+	}
+	mMissed.clear();
+	mMissedTotal = 0;
+}
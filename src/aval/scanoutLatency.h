@@ -0,0 +1,105 @@
+// Copyright (c) 2017-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <string>
+#include "drmEvents.h"
+
+//Operations whose submit-to-scanout latency is tracked
+typedef enum
+{
+	SCANOUT_OP_MODESET = 0,   //setActiveMode, e.g. setDisplayResolution
+	SCANOUT_OP_PLANE_UPDATE,  //window geometry/fb/zorder, e.g. applyScaling
+	SCANOUT_OP_PAGE_FLIP,     //DrmCrtc::pageFlip
+	SCANOUT_OP_COUNT
+} SCANOUT_OP_T;
+
+//Log2 histogram of latencies in microseconds, bucket i holds [2^i, 2^(i+1)).
+struct LatencyHistogram
+{
+	static constexpr unsigned BUCKETS = 24; //last bucket collects everything above 8s
+
+	uint64_t buckets[BUCKETS] = {0};
+	uint64_t count = 0;
+	uint64_t sumUs = 0;
+	uint64_t maxUs = 0;
+
+	void record(uint64_t us);
+	uint64_t meanUs() const { return count ? sumUs / count : 0; }
+	uint64_t percentileUs(unsigned percent) const; //upper bound of the bucket holding it
+};
+
+class ScanoutLatencyTracker;
+
+//A commit waiting for the vblank or flip event that puts it on screen
+struct ScanoutSubmission
+{
+	ScanoutLatencyTracker *tracker = nullptr;
+	SCANOUT_OP_T op = SCANOUT_OP_PLANE_UPDATE;
+	uint32_t crtcId = 0;
+	uint64_t submitUs = 0;   //CLOCK_MONOTONIC
+	uint32_t targetSeq = 0;  //vblank the commit was meant for
+	bool seqKnown = false;
+
+	bool active() const { return tracker != nullptr; }
+	//Record the latency against the kernel event timestamp and reset
+	void complete(unsigned int sequence, unsigned int tvSec, unsigned int tvUsec);
+};
+
+//Matches commits to the kernel timestamp of the vblank they became visible on.
+//Event timestamps are CLOCK_MONOTONIC, the kernel default for DRM_CAP_TIMESTAMP_MONOTONIC.
+class ScanoutLatencyTracker
+{
+public:
+	ScanoutLatencyTracker() {}
+	ScanoutLatencyTracker(const ScanoutLatencyTracker&) = delete;
+	ScanoutLatencyTracker& operator=(const ScanoutLatencyTracker&) = delete;
+
+	static uint64_t now();
+	static const char* opName(SCANOUT_OP_T op);
+
+	//Stamp a commit about to be submitted. targetSeq is the vblank after
+	//the current one unless the caller already knows the vblank sequence.
+	ScanoutSubmission submit(int fd, uint32_t crtcIndex, uint32_t crtcId, SCANOUT_OP_T op);
+	//For commits without a completion event of their own (blocking and legacy
+	//ioctls), time them against the next vblank after they returned.
+	void completeOnVblank(int fd, uint32_t crtcIndex, const ScanoutSubmission &submission);
+
+	void record(const ScanoutSubmission &submission, unsigned int sequence, unsigned int tvSec, unsigned int tvUsec);
+
+	const LatencyHistogram& histogram(SCANOUT_OP_T op) const { return mHistograms[op]; }
+	uint64_t missedVblanks(uint32_t crtcId) const;
+	uint64_t missedVblanks() const { return mMissedTotal; }
+	std::string summary() const;
+	void reset();
+
+private:
+	struct VblankWaiter : public DrmEventListener
+	{
+		ScanoutSubmission submission;
+		void onVblank(unsigned int sequence, unsigned int tvSec, unsigned int tvUsec) override;
+	};
+
+	LatencyHistogram mHistograms[SCANOUT_OP_COUNT];
+	std::map<uint32_t, uint64_t> mMissed; //per crtc id
+	uint64_t mMissedTotal = 0;
+	std::list<VblankWaiter> mWaiters; //node based, listener addresses stay valid
+};
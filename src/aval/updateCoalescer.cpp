@@ -0,0 +1,212 @@
+// Copyright (c) 2017-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <cstring>
+#include <cinttypes>
+#include "updateCoalescer.h"
+#include "logging.h"
+
+PlaneUpdateCoalescer::PlaneUpdateCoalescer(DriDevice &device):mDevice(device)
+{
+}
+
+PlaneUpdateCoalescer::CrtcQueue& PlaneUpdateCoalescer::queueFor(uint32_t crtcId)
+{
+	CrtcQueue &queue = mQueues[crtcId];
+	if (!queue.owner)
+	{
+		queue.owner = this;
+		queue.crtcId = crtcId;
+		for (auto &crtc : mDevice.crtcList)
+		{
+			if (crtc.mCrtc->crtc_id == crtcId)
+			{
+				queue.crtcIndex = crtc.crtc_index;
+			}
+		}
+	}
+	return queue;
+}
+
+void PlaneUpdateCoalescer::hold(uint32_t crtcId, bool held)
+{
+	CrtcQueue &queue = queueFor(crtcId);
+	queue.held = held;
+	if (!held && !queue.planes.empty() && !queue.armed)
+	{
+		arm(queue);
+	}
+}
+
+void PlaneUpdateCoalescer::queue(const DrmPlaneState &state)
+{
+	CrtcQueue &queue = queueFor(state.crtcId);
+
+	mStats.updates++;
+	if (!queue.queued.active())
+	{
+		//Latency runs from the AVAL call, the wait for vblank is part of it
+		queue.queued = mDevice.latency.submit(-1, queue.crtcIndex, queue.crtcId, SCANOUT_OP_PLANE_UPDATE);
+	}
+	auto queued = queue.planes.find(state.planeId);
+	if (queued != queue.planes.end())
+	{
+		queued->second = state;
+		mStats.merged++;
+	}
+	else
+	{
+		queue.planes.emplace(state.planeId, state);
+	}
+
+	if (!queue.armed && !queue.held)
+	{
+		arm(queue);
+	}
+}
+
+bool PlaneUpdateCoalescer::pending(uint32_t planeId, DrmPlaneState &state) const
+{
+	for (auto &entry : mQueues)
+	{
+		auto queued = entry.second.planes.find(planeId);
+		if (queued != entry.second.planes.end())
+		{
+			state = queued->second;
+			return true;
+		}
+	}
+	return false;
+}
+
+void PlaneUpdateCoalescer::arm(CrtcQueue &queue)
+{
+	int ret = requestVblankEvent(mDevice.drmModuleFd, queue.crtcIndex, &queue);
+	if (ret)
+	{
+		//crtc is off or has no vblank irq, nothing to align to
+		LOG_DEBUG("No vblank event for crtc %u (%s), flushing now", queue.crtcId, strerror(-ret));
+		flush(queue, false);
+		return;
+	}
+	queue.armed = true;
+}
+
+void PlaneUpdateCoalescer::CrtcQueue::onVblank(unsigned int sequence, unsigned int tvSec, unsigned int tvUsec)
+{
+	armed = false;
+	//Flushed now, so the commit is meant for the following vblank
+	queued.targetSeq = sequence + 1;
+	queued.seqKnown = true;
+	owner->flush(*this, true);
+}
+
+void PlaneUpdateCoalescer::CrtcQueue::onPageFlip(unsigned int sequence, unsigned int tvSec, unsigned int tvUsec)
+{
+	inFlight.complete(sequence, tvSec, tvUsec);
+}
+
+void PlaneUpdateCoalescer::flush(uint32_t crtcId)
+{
+	auto queue = mQueues.find(crtcId);
+	if (queue != mQueues.end())
+	{
+		flush(queue->second, false);
+	}
+}
+
+void PlaneUpdateCoalescer::flushAll()
+{
+	for (auto &entry : mQueues)
+	{
+		flush(entry.second, false);
+	}
+}
+
+void PlaneUpdateCoalescer::flush(CrtcQueue &queue, bool nonBlocking)
+{
+	if (queue.planes.empty() || queue.held)
+	{
+		return;
+	}
+
+	std::vector<DrmPlaneState> states;
+	for (auto &entry : queue.planes)
+	{
+		const DrmPlaneState &state = entry.second;
+		DrmPlane *plane = mDevice.findPlane(state.planeId);
+		//A plane that stays off only needs its new state remembered
+		if (plane && !state.fbId && !plane->state.fbId)
+		{
+			plane->state = state;
+			continue;
+		}
+		states.push_back(state);
+	}
+
+	//Nonblocking atomic commits report their scanout through a flip event,
+	//everything else is timed against the vblank after it returned
+	bool flipEvent = nonBlocking && mDevice.atomicSupported;
+	uint32_t flags = flipEvent ? DRM_MODE_ATOMIC_NONBLOCK | DRM_MODE_PAGE_FLIP_EVENT : 0;
+	int ret = states.empty() ? 0 : mDevice.commitPlanes(states, flags, flipEvent ? &queue : nullptr);
+	if (ret == -EBUSY)
+	{
+		//Previous commit has not landed yet, retry on the next vblank
+		mStats.deferred++;
+		arm(queue);
+		return;
+	}
+	if (!states.empty())
+	{
+		mStats.commits++;
+	}
+	if (!ret && !states.empty())
+	{
+		if (flipEvent)
+		{
+			queue.inFlight = queue.queued;
+		}
+		else
+		{
+			mDevice.latency.completeOnVblank(mDevice.drmModuleFd, queue.crtcIndex, queue.queued);
+		}
+	}
+	queue.queued = ScanoutSubmission();
+	if (ret)
+	{
+		mStats.failed++;
+		LOG_ERROR(MSGID_DRM_SET_PLANE_FAILED, 0, "Flushing %zu plane updates on crtc %u failed: %s",
+		          states.size(), queue.crtcId, strerror(-ret));
+		//The callers were already told their update went through, so one bad
+		//plane must not take the others down with it: apply them one by one
+		if (states.size() > 1)
+		{
+			for (const DrmPlaneState &state : states)
+			{
+				int planeRet = mDevice.commitPlanes({state}, 0);
+				if (planeRet)
+				{
+					mStats.failed++;
+					LOG_ERROR(MSGID_DRM_SET_PLANE_FAILED, 0, "Plane %u update (fb %u) on crtc %u rejected: %s",
+					          state.planeId, state.fbId, queue.crtcId, strerror(-planeRet));
+				}
+			}
+		}
+	}
+	LOG_DEBUG("crtc %u flushed %zu planes, %" PRIu64 " of %" PRIu64 " updates merged so far",
+	          queue.crtcId, states.size(), mStats.merged, mStats.updates);
+	queue.planes.clear();
+}
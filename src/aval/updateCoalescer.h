@@ -0,0 +1,68 @@
+// Copyright (c) 2017-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <vector>
+#include "driElements.h"
+#include "drmEvents.h"
+
+//Collects plane updates made between two vblanks and applies them as one
+//commit per crtc on the next vblank. A newer update of a plane replaces the
+//queued one, so bursts of window changes cost one commit per frame.
+class PlaneUpdateCoalescer
+{
+public:
+	explicit PlaneUpdateCoalescer(DriDevice &device);
+
+	PlaneUpdateCoalescer(const PlaneUpdateCoalescer&) = delete;
+	PlaneUpdateCoalescer& operator=(const PlaneUpdateCoalescer&) = delete;
+
+	void queue(const DrmPlaneState &state);
+	bool pending(uint32_t planeId, DrmPlaneState &state) const;
+	void flush(uint32_t crtcId);
+	void flushAll();
+	//Keep updates of a crtc queued, e.g. while a modeset on it is in flight
+	void hold(uint32_t crtcId, bool held);
+
+	const PlaneUpdateStats& stats() const { return mStats; }
+
+private:
+	struct CrtcQueue : public DrmEventListener
+	{
+		PlaneUpdateCoalescer *owner = nullptr;
+		uint32_t crtcId = 0;
+		uint32_t crtcIndex = 0;
+		bool armed = false; //vblank event requested
+		bool held = false;
+		std::map<uint32_t, DrmPlaneState> planes;
+		ScanoutSubmission queued;   //stamped by the first update of the batch
+		ScanoutSubmission inFlight; //nonblocking commit waiting for its flip event
+
+		void onVblank(unsigned int sequence, unsigned int tvSec, unsigned int tvUsec) override;
+		void onPageFlip(unsigned int sequence, unsigned int tvSec, unsigned int tvUsec) override;
+	};
+
+	CrtcQueue& queueFor(uint32_t crtcId);
+	void arm(CrtcQueue &queue);
+	void flush(CrtcQueue &queue, bool nonBlocking);
+
+	DriDevice &mDevice;
+	std::map<uint32_t, CrtcQueue> mQueues; //node based, listener addresses stay valid
+	PlaneUpdateStats mStats;
+};
@@ -62,6 +62,46 @@ DeviceCapability::DeviceCapability(const std::string& configFilePath)
 		{
 			parsePlanes(configJson["planes"]);
 		}
+		if (configJson.hasKey("planeOutputs"))
+		{
+			parsePlaneOutputs(configJson["planeOutputs"]);
+		}
+		if (configJson.hasKey("scanoutFbCacheBudgetMB"))
+		{
+			int32_t budget = configJson["scanoutFbCacheBudgetMB"].asNumber<int32_t>();
+			if (budget >= 0)
+			{
+				mScanoutFbCacheBudget = static_cast<size_t>(budget) << 20;
+			}
+			else
+			{
+				LOG_ERROR(MSGID_CONFFILE_MISCONFIGURED, 0, "Invalid scanoutFbCacheBudgetMB %d, using default", budget);
+			}
+		}
+		if (configJson.hasKey("bufferPoolBudgetMB"))
+		{
+			int32_t budget = configJson["bufferPoolBudgetMB"].asNumber<int32_t>();
+			if (budget >= 0)
+			{
+				mBufferPoolBudget = static_cast<size_t>(budget) << 20;
+			}
+			else
+			{
+				LOG_ERROR(MSGID_CONFFILE_MISCONFIGURED, 0, "Invalid bufferPoolBudgetMB %d, using default", budget);
+			}
+		}
+		if (configJson.hasKey("hotplugDebounceMs"))
+		{
+			int32_t debounce = configJson["hotplugDebounceMs"].asNumber<int32_t>();
+			if (debounce >= 0)
+			{
+				mHotplugDebounceMs = static_cast<uint32_t>(debounce);
+			}
+			else
+			{
+				LOG_ERROR(MSGID_CONFFILE_MISCONFIGURED, 0, "Invalid hotplugDebounceMs %d, using default", debounce);
+			}
+		}
 		if (configJson.hasKey("audioMasterDefault"))
 		{
 			LOG_DEBUG("Found audioMasterDefault");
@@ -122,6 +162,20 @@ void DeviceCapability::parsePlanes(pbnjson::JValue element)
 	}
 }
 
+void DeviceCapability::parsePlaneOutputs(pbnjson::JValue element)
+{
+	if (!element.isObject())
+	{
+		LOG_ERROR(MSGID_CONFFILE_MISCONFIGURED, 0, "Failed to read plane outputs. all planes on the primary output.");
+		return;
+	}
+	mPlaneOutputs.clear();
+	for (const pbnjson::JValue::KeyValue &kv : element.children())
+	{
+		mPlaneOutputs[kv.first.asString()] = kv.second.asString();
+	}
+}
+
 DeviceCapability::~DeviceCapability()
 {
 	LOG_DEBUG("Destroy DeviceCapability");
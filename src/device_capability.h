@@ -19,6 +19,7 @@
 #include <string>
 #include <pbnjson/cxx/JValue.h>
 #include <set>
+#include <map>
 #include <aval/aval_video.h>
 
 
@@ -63,6 +64,18 @@ public:
 	{
 		return mPlaneNames;
 	};
+	//Output a plane is shown on, e.g. "DSI-1". Empty for the primary output.
+	std::string getPlaneOutput(const std::string &planeName)
+	{
+		auto output = mPlaneOutputs.find(planeName);
+		return output != mPlaneOutputs.end() ? output->second : std::string();
+	}
+	//Bytes of idle scanout buffers kept for mode switches, 0 disables the cache
+	size_t getScanoutFbCacheBudget() { return mScanoutFbCacheBudget; }
+	//Bytes of freed dumb buffers kept for reuse, 0 disables the pool
+	size_t getBufferPoolBudget() { return mBufferPoolBudget; }
+	//Quiet period before a burst of hotplug events is applied
+	uint32_t getHotplugDebounceMs() { return mHotplugDebounceMs; }
 private:
 
 	AudioDefaults mAudioDefaults;
@@ -82,8 +95,13 @@ private:
 	/*note:in hdmi_safe mode w and h printed by tvservice is 640x480 which is listed the minimum res in device-cap.json*/
 
 	std::set<std::string> mPlaneNames = {"MAIN"};
+	std::map<std::string, std::string> mPlaneOutputs; //plane name -> output name
+	size_t mScanoutFbCacheBudget = 32 << 20;
+	size_t mBufferPoolBudget = 16 << 20;
+	uint32_t mHotplugDebounceMs = 100;
 	void parseResolution(DeviceModeResolution &resolution, pbnjson::JValue object);
 	void parsePlanes(pbnjson::JValue element);
+	void parsePlaneOutputs(pbnjson::JValue element);
 
 	void parseAudioDefaults(pbnjson::JValue element);
 };
@@ -109,6 +109,8 @@ private:
 #define MSGID_UDEV_ERROR                 "MSGID_UDEV__ERROR"
 #define MSGID_DEVICE_ERROR               "MSGID_DEVICE_ERROR"
 #define MSGID_DRM_MODESET_ERROR          "MSGID_DRM_MODESET_ERROR"
+#define MSGID_DRM_ATOMIC_COMMIT_FAILED   "DRM_ATOMIC_COMMIT_FAILED"
+#define MSGID_EDID_CACHE_ERROR           "EDID_CACHE_ERROR"
 
 //video errors
 #define MSGID_VIDEO_CONNECT_FAILED       "VIDEO_CONNECT_FAILED"
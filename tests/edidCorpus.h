@@ -0,0 +1,68 @@
+// Copyright (c) 2017-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+#pragma once
+
+//EDID corpus for edidTest. Each entry reproduces a class of sink with known
+//contents, so every decoded field can be checked:
+// EDID_HDMI_TV       1080p HDMI TV: CEA-861 rev 3 extension with VICs, LPCM
+//                    and AC-3 audio, HDMI VSDB and two extension timings
+// EDID_DVI_MONITOR   1680x1050 DVI monitor, base block only
+// EDID_BAD_CHECKSUM  EDID_DVI_MONITOR with one bit flipped in the base block
+//More binaries, e.g. read from /sys/class/drm/card0-HDMI-A-1/edid, can be
+//passed to edidTest as arguments.
+
+static const unsigned char EDID_HDMI_TV[] = {
+	0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0x4c, 0x2d, 0x6a, 0x0b, 0x00, 0x0e, 0x00, 0x01,
+	0x1e, 0x1a, 0x01, 0x03, 0x80, 0xa0, 0x5a, 0x78, 0x0a, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x3a, 0x80, 0x18, 0x71, 0x38, 0x2d, 0x40, 0x58, 0x2c,
+	0x45, 0x00, 0x40, 0x84, 0x63, 0x00, 0x00, 0x1e, 0x01, 0x1d, 0x00, 0x72, 0x51, 0xd0, 0x1e, 0x20,
+	0x6e, 0x28, 0x55, 0x00, 0x40, 0x84, 0x63, 0x00, 0x00, 0x1e, 0x00, 0x00, 0x00, 0xfd, 0x00, 0x32,
+	0x4c, 0x1e, 0x50, 0x11, 0x00, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x00, 0x00, 0x00, 0xfc,
+	0x00, 0x53, 0x41, 0x4d, 0x53, 0x55, 0x4e, 0x47, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x01, 0x31,
+	0x02, 0x03, 0x22, 0xf1, 0x4a, 0x90, 0x04, 0x1f, 0x13, 0x05, 0x14, 0x20, 0x22, 0x03, 0x02, 0x26,
+	0x09, 0x07, 0x07, 0x15, 0x07, 0x50, 0x83, 0x01, 0x00, 0x00, 0x67, 0x03, 0x0c, 0x00, 0x10, 0x00,
+	0xb8, 0x2d, 0x8c, 0x0a, 0xd0, 0x8a, 0x20, 0xe0, 0x2d, 0x10, 0x10, 0x3e, 0x96, 0x00, 0x40, 0x84,
+	0x63, 0x00, 0x00, 0x18, 0x01, 0x1d, 0x80, 0x18, 0x71, 0x1c, 0x16, 0x20, 0x58, 0x2c, 0x25, 0x00,
+	0x40, 0x84, 0x63, 0x00, 0x00, 0x9e, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xa9,
+};
+
+static const unsigned char EDID_DVI_MONITOR[] = {
+	0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0x10, 0xac, 0x2a, 0xa0, 0x4c, 0x35, 0x32, 0x30,
+	0x0c, 0x13, 0x01, 0x03, 0x80, 0x2f, 0x1e, 0x78, 0x0a, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7c, 0x2e, 0x90, 0xa0, 0x60, 0x1a, 0x1e, 0x40, 0x30, 0x20,
+	0x36, 0x00, 0xd9, 0x28, 0x11, 0x00, 0x00, 0x1a, 0x00, 0x00, 0x00, 0xff, 0x00, 0x47, 0x37, 0x38,
+	0x32, 0x54, 0x39, 0x41, 0x33, 0x30, 0x32, 0x35, 0x4c, 0x0a, 0x00, 0x00, 0x00, 0xfd, 0x00, 0x32,
+	0x4c, 0x1e, 0x50, 0x11, 0x00, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x00, 0x00, 0x00, 0xfc,
+	0x00, 0x44, 0x45, 0x4c, 0x4c, 0x20, 0x32, 0x32, 0x30, 0x39, 0x57, 0x41, 0x0a, 0x20, 0x00, 0x62,
+};
+
+static const unsigned char EDID_BAD_CHECKSUM[] = {
+	0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0x10, 0xac, 0x2a, 0xa0, 0x4c, 0x35, 0x32, 0x30,
+	0x0c, 0x13, 0x01, 0x03, 0x80, 0x2f, 0x1e, 0x78, 0x0a, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7c, 0x2e, 0x90, 0xa0, 0x60, 0x1a, 0x1e, 0x40, 0x30, 0x20,
+	0x37, 0x00, 0xd9, 0x28, 0x11, 0x00, 0x00, 0x1a, 0x00, 0x00, 0x00, 0xff, 0x00, 0x47, 0x37, 0x38,
+	0x32, 0x54, 0x39, 0x41, 0x33, 0x30, 0x32, 0x35, 0x4c, 0x0a, 0x00, 0x00, 0x00, 0xfd, 0x00, 0x32,
+	0x4c, 0x1e, 0x50, 0x11, 0x00, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x00, 0x00, 0x00, 0xfc,
+	0x00, 0x44, 0x45, 0x4c, 0x4c, 0x20, 0x32, 0x32, 0x30, 0x39, 0x57, 0x41, 0x0a, 0x20, 0x00, 0x62,
+};
@@ -0,0 +1,201 @@
+// Copyright (c) 2017-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+#include "edid.h"
+#include "edidCorpus.h"
+#include "testCheck.h"
+
+static void testHdmiTv()
+{
+	EdidView edid(EDID_HDMI_TV, sizeof(EDID_HDMI_TV));
+	CHECK(edid.valid());
+	CHECK(edid.blockCount() == 2);
+	CHECK(edid.blockChecksumOk(1));
+
+	char vendor[4];
+	edid.manufacturer(vendor);
+	CHECK(!strcmp(vendor, "SAM"));
+	CHECK(edid.productCode() == 0x0b6a);
+	CHECK(edid.serialNumber() == 0x01000e00);
+	CHECK(edid.week() == 30);
+	CHECK(edid.year() == 2016);
+	CHECK(edid.version() == 1 && edid.revision() == 3);
+	CHECK(edid.digitalInput());
+	CHECK(edid.widthCm() == 160 && edid.heightCm() == 90);
+	char name[14];
+	CHECK(edid.monitorName(name, sizeof(name)) == 7);
+	CHECK(!strcmp(name, "SAMSUNG"));
+
+	//Two in the base block, two in the CEA extension
+	CHECK(edid.detailedTimingCount() == 4);
+	EdidDetailedTiming t;
+	CHECK(edid.detailedTiming(0, t));
+	CHECK(t.pixelClockKHz == 148500);
+	CHECK(t.hActive == 1920 && t.hBlank == 280 && t.hSyncOffset == 88 && t.hSyncWidth == 44);
+	CHECK(t.vActive == 1080 && t.vBlank == 45 && t.vSyncOffset == 4 && t.vSyncWidth == 5);
+	CHECK(t.widthMm == 1600 && t.heightMm == 900);
+	CHECK(!t.interlaced && t.hSyncPositive && t.vSyncPositive);
+	CHECK(edid.detailedTiming(1, t));
+	CHECK(t.pixelClockKHz == 74250 && t.hActive == 1280 && t.vActive == 720 && t.hSyncOffset == 110);
+	CHECK(edid.detailedTiming(2, t));
+	CHECK(t.pixelClockKHz == 27000 && t.hActive == 720 && t.vActive == 480);
+	CHECK(t.vSyncOffset == 9 && t.vSyncWidth == 6 && !t.hSyncPositive && !t.vSyncPositive);
+	CHECK(edid.detailedTiming(3, t));
+	CHECK(t.interlaced && t.hActive == 1920 && t.vActive == 540 && t.vBlank == 22);
+	CHECK(!edid.detailedTiming(4, t));
+
+	CHECK(edid.hasCea());
+	CHECK(edid.ceaRevision() == 3);
+	CHECK(edid.underscan() && edid.basicAudio() && edid.ycbcr444() && edid.ycbcr422());
+
+	const uint8_t vics[] = {16, 4, 31, 19, 5, 20, 32, 34, 3, 2};
+	CHECK(edid.vicCount() == sizeof(vics));
+	for (size_t i = 0; i < sizeof(vics); i++)
+	{
+		uint8_t code = 0;
+		bool native = false;
+		CHECK(edid.vic(i, code, native));
+		CHECK(code == vics[i]);
+		CHECK(native == (i == 0));
+	}
+	uint8_t code;
+	bool native;
+	CHECK(!edid.vic(sizeof(vics), code, native));
+
+	CHECK(edid.shortAudioCount() == 2);
+	EdidShortAudio sad;
+	CHECK(edid.shortAudio(0, sad));
+	CHECK(sad.format == 1 && sad.maxChannels == 2 && sad.sampleRates == 0x07 && sad.detail == 0x07);
+	CHECK(edid.shortAudio(1, sad));
+	CHECK(sad.format == 2 && sad.maxChannels == 6 && sad.detail * 8 == 640);
+	CHECK(!edid.shortAudio(2, sad));
+
+	EdidHdmiVsdb vsdb;
+	CHECK(edid.hdmiVsdb(vsdb));
+	CHECK(vsdb.physicalAddress == 0x1000);
+	CHECK(vsdb.supportsAI && vsdb.deepColor30 && vsdb.deepColor36 && !vsdb.deepColor48 && vsdb.deepColorY444);
+	CHECK(vsdb.maxTmdsClockMHz == 225);
+
+	//Extension announced but cut off: only the base block is decoded
+	EdidView truncated(EDID_HDMI_TV, 200);
+	CHECK(truncated.valid());
+	CHECK(truncated.blockCount() == 1);
+	CHECK(!truncated.hasCea());
+	CHECK(truncated.detailedTimingCount() == 2);
+	CHECK(truncated.vicCount() == 0);
+}
+
+static void testDviMonitor()
+{
+	EdidView edid(EDID_DVI_MONITOR, sizeof(EDID_DVI_MONITOR));
+	CHECK(edid.valid());
+	CHECK(edid.blockCount() == 1);
+	char vendor[4];
+	edid.manufacturer(vendor);
+	CHECK(!strcmp(vendor, "DEL"));
+	CHECK(edid.year() == 2009);
+	char name[14];
+	CHECK(edid.monitorName(name, sizeof(name)) == 11);
+	CHECK(!strcmp(name, "DELL 2209WA"));
+	char shortName[5];
+	CHECK(edid.monitorName(shortName, sizeof(shortName)) == 4);
+	CHECK(!strcmp(shortName, "DELL"));
+
+	CHECK(edid.detailedTimingCount() == 1);
+	EdidDetailedTiming t;
+	CHECK(edid.detailedTiming(0, t));
+	CHECK(t.pixelClockKHz == 119000 && t.hActive == 1680 && t.vActive == 1050);
+	CHECK(t.hSyncPositive && !t.vSyncPositive);
+	CHECK(t.widthMm == 473 && t.heightMm == 296);
+
+	CHECK(!edid.hasCea());
+	CHECK(!edid.basicAudio());
+	CHECK(edid.shortAudioCount() == 0);
+	EdidHdmiVsdb vsdb;
+	CHECK(!edid.hdmiVsdb(vsdb));
+}
+
+static void testInvalid()
+{
+	EdidView bad(EDID_BAD_CHECKSUM, sizeof(EDID_BAD_CHECKSUM));
+	CHECK(!bad.valid());
+	CHECK(bad.blockCount() == 0);
+	CHECK(bad.detailedTimingCount() == 0);
+	char name[14];
+	CHECK(bad.monitorName(name, sizeof(name)) == 0 && !name[0]);
+
+	EdidView empty(nullptr, 0);
+	CHECK(!empty.valid());
+	CHECK(!empty.hasCea());
+	EdidView shortBlob(EDID_DVI_MONITOR, 100);
+	CHECK(!shortBlob.valid());
+
+	Edid none;
+	CHECK(!none.data() && !none.size() && !none.view().valid());
+}
+
+//Captured binaries: whatever they contain, decoding must stay inside the blob
+static void testCaptured(const char *path)
+{
+	std::ifstream file(path, std::ios::binary);
+	std::vector<unsigned char> blob((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	EdidView edid(blob.data(), blob.size());
+	char vendor[4];
+	char name[14];
+	edid.manufacturer(vendor);
+	edid.monitorName(name, sizeof(name));
+	EdidDetailedTiming t;
+	size_t timings = edid.detailedTimingCount();
+	for (size_t i = 0; i < timings; i++)
+	{
+		CHECK(edid.detailedTiming(i, t));
+		CHECK(t.pixelClockKHz && t.hActive && t.vActive);
+	}
+	uint8_t code;
+	bool native;
+	for (size_t i = 0; i < edid.vicCount(); i++)
+	{
+		CHECK(edid.vic(i, code, native));
+	}
+	EdidShortAudio sad;
+	for (size_t i = 0; i < edid.shortAudioCount(); i++)
+	{
+		CHECK(edid.shortAudio(i, sad));
+	}
+	std::cout << path << ": " << (edid.valid() ? "valid" : "invalid") << ", " << vendor << " " << name
+	          << ", " << edid.blockCount() << " blocks, " << timings << " timings, "
+	          << edid.vicCount() << " VICs, " << edid.shortAudioCount() << " audio descriptors" << std::endl;
+}
+
+int main(int argc, const char *argv[])
+{
+	testHdmiTv();
+	testDviMonitor();
+	testInvalid();
+	for (int i = 1; i < argc; i++)
+	{
+		testCaptured(argv[i]);
+	}
+	return testResult();
+}
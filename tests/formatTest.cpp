@@ -0,0 +1,103 @@
+// Copyright (c) 2017-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+
+#include <iostream>
+#include <drm_fourcc.h>
+#include "formatNegotiation.h"
+#include "pixelFormat.h"
+#include "testCheck.h"
+
+//Format table lookups and plane format negotiation against made up planes,
+//no device needed.
+//
+//usage: formatTest
+
+static PlaneFormatSet makeFormats(std::vector<uint32_t> formats)
+{
+	drmModePlane plane = {};
+	plane.count_formats = formats.size();
+	plane.formats = formats.data();
+	PlaneFormatSet set;
+	set.load(-1, &plane, 0); //no IN_FORMATS blob, linear only
+	return set;
+}
+
+static void testFormatTable()
+{
+	for (size_t i = 0; i < FORMAT_INFO_COUNT; i++)
+	{
+		const struct util_format_info *info = util_format_info_find(format_info[i].format);
+		CHECK(info && info->format == format_info[i].format);
+		CHECK(util_format_fourcc(format_info[i].name) == format_info[i].format);
+	}
+	CHECK(!util_format_info_find(DRM_FORMAT_P010));
+	CHECK(!util_format_fourcc("P010"));
+	CHECK(!util_format_fourcc("NV1"));
+
+	unsigned int handles[4] = {0}, pitches[4] = {0}, offsets[4] = {0};
+	util_format_layout(util_format_info_find(DRM_FORMAT_NV12), 1080, 1920, 7, handles, pitches, offsets);
+	CHECK(handles[1] == 7 && pitches[1] == 1920 && offsets[1] == 1920 * 1080 && !handles[2]);
+}
+
+static void testNegotiation()
+{
+	PlaneFormatSet primary = makeFormats({DRM_FORMAT_XRGB8888, DRM_FORMAT_ARGB8888, DRM_FORMAT_NV12});
+	PlaneFormatSet rgbOverlay = makeFormats({DRM_FORMAT_RGB565, DRM_FORMAT_XBGR8888});
+	PlaneFormatSet yuvOverlay = makeFormats({DRM_FORMAT_XRGB8888, DRM_FORMAT_NV12, DRM_FORMAT_YUV420});
+
+	CHECK(yuvOverlay.supports(DRM_FORMAT_NV12));
+	CHECK(yuvOverlay.supports(DRM_FORMAT_NV12, DRM_FORMAT_MOD_INVALID));
+	CHECK(!yuvOverlay.supports(DRM_FORMAT_NV12, DRM_FORMAT_MOD_BROADCOM_VC4_T_TILED));
+	CHECK(!rgbOverlay.supports(DRM_FORMAT_NV12));
+
+	std::vector<FormatCandidate> all = {
+		{1, DRM_PLANE_TYPE_PRIMARY, &primary},
+		{2, DRM_PLANE_TYPE_OVERLAY, &rgbOverlay},
+		{3, DRM_PLANE_TYPE_OVERLAY, &yuvOverlay},
+	};
+
+	//NV12 scanned out as is beats the client's first choice of RGB
+	FormatChoice choice = negotiateFormat({{DRM_FORMAT_XRGB8888, DRM_FORMAT_MOD_LINEAR},
+	                                       {DRM_FORMAT_NV12, DRM_FORMAT_MOD_LINEAR}}, all);
+	CHECK(choice.path == FORMAT_PATH_DIRECT);
+	CHECK(choice.planeId == 3 && choice.offer == 1 && choice.format == DRM_FORMAT_NV12);
+
+	//The primary plane also takes NV12 but is kept for the output's own fb
+	choice = negotiateFormat({{DRM_FORMAT_NV12, DRM_FORMAT_MOD_LINEAR}}, {all[0], all[2]});
+	CHECK(choice.path == FORMAT_PATH_DIRECT && choice.planeId == 3);
+
+	//Without a YUV plane the NV12 frame has to be converted
+	choice = negotiateFormat({{DRM_FORMAT_NV12, DRM_FORMAT_MOD_LINEAR}}, {all[1]});
+	CHECK(choice.path == FORMAT_PATH_CONVERT);
+	CHECK(choice.planeId == 2 && choice.format == DRM_FORMAT_XBGR8888);
+
+	//A tiled frame can neither be scanned out here nor read by the CPU
+	choice = negotiateFormat({{DRM_FORMAT_NV12, DRM_FORMAT_MOD_BROADCOM_VC4_T_TILED}}, {all[1]});
+	CHECK(choice.path == FORMAT_PATH_NONE);
+
+	choice = negotiateFormat({}, all);
+	CHECK(choice.path == FORMAT_PATH_NONE);
+}
+
+int main(int argc, char **argv)
+{
+	testFormatTable();
+	testNegotiation();
+
+	return testResult();
+}
@@ -0,0 +1,160 @@
+// Copyright (c) 2017-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+
+#include <glob.h>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <glib.h>
+#include "driElements.h"
+#include "logging.h"
+
+//Hotplug soak test for the ownership of libdrm objects. Brings DRIElements up
+//and down repeatedly and, while it is up, forces connectors off and on through
+//sysfs so every hotplug replaces connector snapshots. Each round ends with
+//full probes racing a thread that keeps unplugging, so connectors are read
+//while their EDID blobs go away. Build with
+//WEBOS_CONFIG_ENABLE_ASAN to have use after free and leaks reported.
+//Needs root, the display goes dark while a connector is forced off.
+//
+//usage: drmHotplugSoak [rounds] [toggles per round]
+
+static const char* const FORCE_STATES[] = {"off", "on", "detect"};
+static const guint TOGGLE_INTERVAL_MS = 300;
+static const int RACE_PROBES = 50;
+
+struct SoakRound
+{
+	GMainLoop *loop;
+	std::vector<std::string> statusFiles;
+	int toggles;
+	int toggled;
+};
+
+static void forceStatus(const std::vector<std::string> &files, const char *state)
+{
+	for (auto &file : files)
+	{
+		std::ofstream status(file);
+		status << state;
+		if (!status)
+		{
+			std::cerr << "cannot write " << state << " to " << file << std::endl;
+		}
+	}
+}
+
+static gboolean toggle(gpointer userData)
+{
+	SoakRound *round = static_cast<SoakRound*>(userData);
+	if (round->toggled == round->toggles)
+	{
+		forceStatus(round->statusFiles, "detect");
+		g_main_loop_quit(round->loop);
+		return G_SOURCE_REMOVE;
+	}
+	forceStatus(round->statusFiles, FORCE_STATES[round->toggled++ % 3]);
+	return G_SOURCE_CONTINUE;
+}
+
+//Full probes while the sinks come and go underneath them. A blob id read with
+//the connector may be stale by the time the EDID is fetched.
+static void probeWhileUnplugging(DRIElements &driElements, const std::vector<std::string> &files)
+{
+	std::atomic<bool> done(false);
+	std::thread unplug([&done, &files]
+	{
+		for (int i = 0; !done; i++)
+		{
+			forceStatus(files, FORCE_STATES[i % 2]);
+		}
+		forceStatus(files, "detect");
+	});
+	for (int i = 0; i < RACE_PROBES; i++)
+	{
+		for (auto &dev : driElements.mDeviceList)
+		{
+			dev.second.probeConnectors();
+		}
+	}
+	done = true;
+	unplug.join();
+}
+
+int main(int argc, const char *argv[])
+{
+	int rounds = argc > 1 ? std::stoi(argv[1]) : 10;
+	int toggles = argc > 2 ? std::stoi(argv[2]) : 30;
+
+	std::vector<std::string> statusFiles;
+	glob_t found;
+	if (!glob("/sys/class/drm/card*-*/status", 0, nullptr, &found))
+	{
+		statusFiles.assign(found.gl_pathv, found.gl_pathv + found.gl_pathc);
+	}
+	globfree(&found);
+	if (statusFiles.empty())
+	{
+		std::cout << "no connectors to hotplug" << std::endl;
+		return 1;
+	}
+
+	int failures = 0;
+	uint64_t notifications[DISPLAY_EDID_CHANGED + 1] = {};
+	for (int i = 0; i < rounds; i++)
+	{
+		uint64_t probes = DrmConnector::sFullProbes;
+		try
+		{
+			AVAL_VIDEO_SIZE_T s; s.w = 1920; s.h = 1080;
+			DRIElements driElements(s, [&notifications](const DisplayChange &change) { notifications[change.type]++; });
+			if (driElements.mDeviceList.empty() || DrmResourceArena::sLiveObjects <= 0)
+			{
+				std::cerr << "round " << i << ": nothing enumerated" << std::endl;
+				failures++;
+			}
+			SoakRound round{g_main_loop_new(nullptr, FALSE), statusFiles, toggles, 0};
+			g_timeout_add(TOGGLE_INTERVAL_MS, toggle, &round);
+			g_main_loop_run(round.loop);
+			g_main_loop_unref(round.loop);
+			probeWhileUnplugging(driElements, statusFiles);
+		}
+		catch (const std::exception &e)
+		{
+			std::cerr << "round " << i << ": " << e.what() << std::endl;
+			failures++;
+		}
+		//Everything read by this round's enumerations must be gone with DRIElements
+		if (DrmResourceArena::sLiveObjects != 0)
+		{
+			std::cerr << "round " << i << ": " << DrmResourceArena::sLiveObjects << " libdrm objects leaked" << std::endl;
+			failures++;
+		}
+		std::cout << "round " << i << ": " << DrmConnector::sFullProbes - probes << " full probes, display changes so far:";
+		for (int type = DISPLAY_CONNECTED; type <= DISPLAY_EDID_CHANGED; type++)
+		{
+			std::cout << " " << notifications[type] << " " << displayChangeName(static_cast<DisplayChangeType>(type)) << ",";
+		}
+		std::cout << std::endl;
+	}
+	std::cout << (failures ? "FAILED" : "PASSED") << " (" << failures << " failures)" << std::endl;
+	return failures ? 1 : 0;
+}
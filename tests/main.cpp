@@ -23,6 +23,8 @@
 #include <algorithm>
 #include <unistd.h>
 #include "buffers.h"
+#include "bufferPool.h"
+#include "mappingCache.h"
 #include "pattern.h"
 #include "logging.h"
 #include "aval/driElements.h"
@@ -39,8 +41,8 @@ int main (int argc, const char *argv[])
 
 		AVAL_VIDEO_SIZE_T s; s.w=1920; s.h=1080;
 		DRIElements driElements(s,
-		                        [](AVAL_VIDEO_SIZE_T min, AVAL_VIDEO_SIZE_T max)
-		                        {std::cout << "callback on device update";});
+		                        [](const DisplayChange &change)
+		                        {std::cout << "\n" << change.output << ": " << displayChangeName(change.type) << std::flush;});
 
 		if (driElements.mPrimaryDev != "")
 		{
@@ -53,25 +55,55 @@ int main (int argc, const char *argv[])
 			auto crtc = std::find_if(driDevice.crtcList.begin(), driDevice.crtcList.end(), [conn](DrmCrtc &c)
 			{ return c.mCrtc->crtc_id == conn->crtc_id; });
 
-			//struct bo *bo = driDevice.crtcList.at(2).boHandle;
-			struct bo *bo = crtc->boHandle;
-
 			//std::cout << "\n crtcid " << driDevice.crtcList.at(2).mCrtc->crtc_id;
 			if (crtc != driDevice.crtcList.end())
 			{
+				//Draw into the back buffer and flip it in, the front buffer is never touched while scanned out
+				struct bo *bo = crtc->backBuffer();
 				std::cout << "\n crtcid " << crtc->mCrtc->crtc_id;
 				std::cout << " " << driDevice.width << " " << driDevice.height << std::endl;
-				std::cout << "bo & fbid" << bo << " " << driDevice.crtcList.at(2).scanout_fbId << std::endl;
+				std::cout << "back bo & front fbid" << bo << " " << crtc->frontFbId() << std::endl;
+
+				fill_pattern(crtc->scanoutFormat, bo, driDevice.width, driDevice.height, UTIL_PATTERN_TILES);
+				crtc->flipDone = [](DrmCrtc &c)
+				{ std::cout << "\n page flip done, front fbid " << c.frontFbId() << std::flush; };
+				std::cout << "page flip " << (crtc->pageFlip(driDevice) ? "failed" : "queued") << std::endl;
 			}
+			std::cout << "modesetting: " << (driDevice.atomicSupported ? "atomic" : "legacy") << std::endl;
 
-			fill_pattern(DEFAULT_PIXEL_FORMAT, bo, driDevice.width, driDevice.height, UTIL_PATTERN_TILES);
+			for (auto &output : driElements.getOutputs())
+			{
+				std::cout << "\n output " << output << ":";
+				for (auto p : driElements.getPlanes(output))
+				{
+					std::cout << " plane " << p;
+				}
+				FormatChoice video = driElements.negotiateFormat({{DRM_FORMAT_NV12, DRM_FORMAT_MOD_LINEAR}},
+				                                                 driElements.getPlanes(output));
+				std::cout << ", NV12 " << formatPathName(video.path) << " on plane " << video.planeId;
+			}
 
-			for (auto p : driElements.getPlanes())
+			//Scale the scanout fb into the first overlay (e.g. vkms with enable_overlay=1)
+			auto planes = driElements.getPlanes();
+			if (!planes.empty() && crtc != driDevice.crtcList.end())
 			{
-				std::cout << "\n plane "<< p;
+				bool ok = driElements.setPlane(planes[0], crtc->frontFbId(),
+				                               driDevice.width / 4, driDevice.height / 4,
+				                               driDevice.width / 2, driDevice.height / 2,
+				                               0, 0, driDevice.width, driDevice.height);
+				driElements.flushPlaneUpdates();
+				std::cout << "\n setPlane on overlay " << planes[0] << (ok ? " succeeded" : " failed");
 			}
 
 		}
+		//Report submit to scanout latency of everything above
+		g_timeout_add_seconds(5, [](gpointer data) -> gboolean
+		{
+			std::cout << "\n" << static_cast<DRIElements*>(data)->getScanoutLatency().summary() << std::endl;
+			std::cout << DumbBufferPool::instance().summary() << std::endl;
+			std::cout << BoMappingCache::instance().summary() << std::endl;
+			return G_SOURCE_CONTINUE;
+		}, &driElements);
 		std::cout << std::flush;
 		g_main_loop_run(loop);
 
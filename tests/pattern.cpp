@@ -820,28 +820,6 @@ static void fill_plain(const struct util_format_info *info, void *planes[3],
 }
 
 
-uint32_t util_format_fourcc(const char *name)
-{
-	unsigned int i;
-
-	for (i = 0; i < ARRAY_SIZE(format_info); i++)
-		if (!strcmp(format_info[i].name, name))
-			return format_info[i].format;
-
-	return 0;
-}
-
-const struct util_format_info *util_format_info_find(uint32_t format)
-{
-	unsigned int i;
-
-	for (i = 0; i < ARRAY_SIZE(format_info); i++)
-		if (format_info[i].format == format)
-			return &format_info[i];
-
-	return NULL;
-}
-
 /*
  * util_fill_pattern - Fill a buffer with a test pattern
  * @format: Pixel format
@@ -891,93 +869,19 @@ void fill_pattern (unsigned int format, struct bo* bo, size_t width, size_t heig
 		        strerror(-errno));
 		return;
 	}
-	uint32_t  pitches[4] = {0}, offsets[4] = {0};
+	const struct util_format_info *info = util_format_info_find(format);
+	if (!info) {
+		bo_unmap(bo);
+		return;
+	}
+
+	unsigned int handles[4] = {0}, pitches[4] = {0}, offsets[4] = {0};
 	void *planes[3] = { 0, };
 
-	/* just testing a limited # of formats to test single
-	 * and multi-planar path.. would be nice to add more..
-	 */
-	switch (format) {
-		case DRM_FORMAT_UYVY:
-		case DRM_FORMAT_VYUY:
-		case DRM_FORMAT_YUYV:
-		case DRM_FORMAT_YVYU:
-			offsets[0] = 0;
-
-			pitches[0] = bo->pitch;
-
-			planes[0] = boMap;
-			break;
-
-		case DRM_FORMAT_NV12:
-		case DRM_FORMAT_NV21:
-		case DRM_FORMAT_NV16:
-		case DRM_FORMAT_NV61:
-			offsets[0] = 0;
-			pitches[0] = bo->pitch;
-			pitches[1] = pitches[0];
-			offsets[1] = pitches[0] * height;
-
-			planes[0] = boMap;
-			planes[1] = boMap + offsets[1];
-			break;
-
-		case DRM_FORMAT_YUV420:
-		case DRM_FORMAT_YVU420:
-			offsets[0] = 0;
-			pitches[0] = bo->pitch;
-			pitches[1] = pitches[0] / 2;
-			offsets[1] = pitches[0] * height;
-			pitches[2] = pitches[1];
-			offsets[2] = offsets[1] + pitches[1] * height / 2;
-
-			planes[0] = boMap;
-			planes[1] = boMap + offsets[1];
-			planes[2] = boMap + offsets[2];
-			break;
-
-		case DRM_FORMAT_ARGB4444:
-		case DRM_FORMAT_XRGB4444:
-		case DRM_FORMAT_ABGR4444:
-		case DRM_FORMAT_XBGR4444:
-		case DRM_FORMAT_RGBA4444:
-		case DRM_FORMAT_RGBX4444:
-		case DRM_FORMAT_BGRA4444:
-		case DRM_FORMAT_BGRX4444:
-		case DRM_FORMAT_ARGB1555:
-		case DRM_FORMAT_XRGB1555:
-		case DRM_FORMAT_ABGR1555:
-		case DRM_FORMAT_XBGR1555:
-		case DRM_FORMAT_RGBA5551:
-		case DRM_FORMAT_RGBX5551:
-		case DRM_FORMAT_BGRA5551:
-		case DRM_FORMAT_BGRX5551:
-		case DRM_FORMAT_RGB565:
-		case DRM_FORMAT_BGR565:
-		case DRM_FORMAT_BGR888:
-		case DRM_FORMAT_RGB888:
-		case DRM_FORMAT_ARGB8888:
-		case DRM_FORMAT_XRGB8888:
-		case DRM_FORMAT_ABGR8888:
-		case DRM_FORMAT_XBGR8888:
-		case DRM_FORMAT_RGBA8888:
-		case DRM_FORMAT_RGBX8888:
-		case DRM_FORMAT_BGRA8888:
-		case DRM_FORMAT_BGRX8888:
-		case DRM_FORMAT_ARGB2101010:
-		case DRM_FORMAT_XRGB2101010:
-		case DRM_FORMAT_ABGR2101010:
-		case DRM_FORMAT_XBGR2101010:
-		case DRM_FORMAT_RGBA1010102:
-		case DRM_FORMAT_RGBX1010102:
-		case DRM_FORMAT_BGRA1010102:
-		case DRM_FORMAT_BGRX1010102:
-
-			pitches[0] = bo->pitch;
-			planes[0] = boMap;
-			break;
-	}
+	util_format_layout(info, height, bo->pitch, bo->handle, handles, pitches, offsets);
+	for (unsigned int i = 0; i < info->planes; i++)
+		planes[i] = boMap + offsets[i];
 
 	util_fill_pattern(format, pattern, planes, width, height, pitches[0]);
-	//bo_unmap(bo);
+	bo_unmap(bo);
 }
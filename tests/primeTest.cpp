@@ -0,0 +1,211 @@
+// Copyright (c) 2017-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <linux/udmabuf.h>
+#include <drm_fourcc.h>
+#include "driElements.h"
+#include "buffers.h"
+#include "bufferPool.h"
+#include "logging.h"
+#include "testCheck.h"
+
+//PRIME export and import on a real device, e.g. vkms loaded with
+//enable_overlay=1. Exports a dumb buffer and imports it back, then imports
+//a memfd backed dma-buf from /dev/udmabuf the way a decoder's buffers would
+//come in, and scans each out on the first overlay plane. Also checks that
+//an exported buffer is never recycled by the buffer pool.
+//
+//usage: drmPrimeTest
+
+static const uint32_t WIDTH = 640;
+static const uint32_t HEIGHT = 480;
+
+static void scanout(DRIElements &driElements, uint32_t fbId)
+{
+	std::vector<uint32_t> planes = driElements.getPlanes();
+	if (planes.empty())
+	{
+		std::cout << "no overlay plane, scanout skipped" << std::endl;
+		return;
+	}
+	CHECK(driElements.setPlane(planes[0], fbId, 0, 0, WIDTH, HEIGHT, 0, 0, WIDTH, HEIGHT, DRM_FORMAT_XRGB8888));
+	//No main loop runs here to deliver the vblank, commit right away
+	driElements.flushPlaneUpdates();
+	//Take the plane off again before the fb goes away
+	CHECK(driElements.setPlane(planes[0], 0, 0, 0, 0, 0, 0, 0, 0, 0));
+	driElements.flushPlaneUpdates();
+}
+
+static void testExportImport(DRIElements &driElements, DriDevice &device)
+{
+	unsigned int handles[4] = {0}, pitches[4] = {0}, offsets[4] = {0};
+	struct bo *bo = bo_create(device.drmModuleFd, DRM_FORMAT_XRGB8888, WIDTH, HEIGHT, handles, pitches, offsets);
+	CHECK(bo);
+	if (!bo)
+	{
+		return;
+	}
+	int primeFd = -1;
+	CHECK(!bo_export(bo, &primeFd));
+
+	DmabufFrame frame;
+	frame.width = WIDTH;
+	frame.height = HEIGHT;
+	frame.format = DRM_FORMAT_XRGB8888;
+	frame.fds[0] = primeFd;
+	frame.pitches[0] = pitches[0];
+	uint32_t fbId = 0;
+	CHECK(driElements.importDmabuf(frame, fbId));
+	CHECK(fbId);
+
+	//Importing its own export must not close the handle of the bo
+	CHECK(bo_owns_handle(device.drmModuleFd, bo->handle));
+	void *ptr = nullptr;
+	CHECK(!bo_map(bo, &ptr));
+	if (ptr)
+	{
+		memset(ptr, 0x80, bo->size);
+		bo_unmap(bo);
+	}
+	scanout(driElements, fbId);
+
+	driElements.releaseDmabuf(fbId);
+	CHECK(device.prime.imported() == 0);
+	close(primeFd);
+	bo_destroy(bo);
+}
+
+static void testExportedNotRecycled(DriDevice &device)
+{
+	unsigned int handles[4] = {0}, pitches[4] = {0}, offsets[4] = {0};
+	struct bo *bo = bo_create(device.drmModuleFd, DRM_FORMAT_XRGB8888, WIDTH, HEIGHT, handles, pitches, offsets);
+	CHECK(bo);
+	if (!bo)
+	{
+		return;
+	}
+	int primeFd = -1;
+	CHECK(!bo_export(bo, &primeFd));
+
+	//The dma-buf outlives the bo, the pool must not keep the memory for reuse
+	DumbBufferPoolStats before = DumbBufferPool::instance().stats();
+	bo_destroy(bo);
+	DumbBufferPoolStats after = DumbBufferPool::instance().stats();
+	CHECK(after.recycled == before.recycled);
+	CHECK(after.retainedBuffers == before.retainedBuffers);
+
+	//A buffer of the same layout comes from the kernel, not from the pool
+	struct bo *next = bo_create(device.drmModuleFd, DRM_FORMAT_XRGB8888, WIDTH, HEIGHT, handles, pitches, offsets);
+	CHECK(next && !next->exported);
+	CHECK(DumbBufferPool::instance().stats().hits == after.hits);
+	bo_destroy(next);
+	close(primeFd);
+}
+
+static void testUdmabuf(DRIElements &driElements, DriDevice &device)
+{
+	int dev = open("/dev/udmabuf", O_RDWR | O_CLOEXEC);
+	if (dev < 0)
+	{
+		std::cout << "no /dev/udmabuf (modprobe udmabuf), import of foreign buffers skipped" << std::endl;
+		return;
+	}
+	size_t pageSize = sysconf(_SC_PAGESIZE);
+	size_t size = (WIDTH * 4 * HEIGHT + pageSize - 1) / pageSize * pageSize;
+	int memfd = memfd_create("drmPrimeTest", MFD_ALLOW_SEALING | MFD_CLOEXEC);
+	CHECK(memfd >= 0);
+	CHECK(!ftruncate(memfd, size));
+	CHECK(fcntl(memfd, F_ADD_SEALS, F_SEAL_SHRINK) == 0);
+
+	void *pixels = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+	CHECK(pixels != MAP_FAILED);
+	if (pixels != MAP_FAILED)
+	{
+		uint32_t *pixel = static_cast<uint32_t*>(pixels);
+		for (uint32_t i = 0; i < WIDTH * HEIGHT; i++)
+		{
+			pixel[i] = (i / WIDTH) * 256 / HEIGHT << 8 | (i % WIDTH) * 256 / WIDTH << 16;
+		}
+		munmap(pixels, size);
+	}
+
+	struct udmabuf_create create;
+	memset(&create, 0, sizeof(create));
+	create.memfd = memfd;
+	create.flags = UDMABUF_FLAGS_CLOEXEC;
+	create.size = size;
+	int dmabuf = ioctl(dev, UDMABUF_CREATE, &create);
+	CHECK(dmabuf >= 0);
+	if (dmabuf >= 0)
+	{
+		DmabufFrame frame;
+		frame.width = WIDTH;
+		frame.height = HEIGHT;
+		frame.format = DRM_FORMAT_XRGB8888;
+		frame.modifier = DRM_FORMAT_MOD_LINEAR;
+		frame.fds[0] = dmabuf;
+		frame.pitches[0] = WIDTH * 4;
+		uint32_t fbId = 0;
+		//Devices without fb modifiers take the implicit layout, which is linear for dumb capable drivers
+		if (!driElements.importDmabuf(frame, fbId))
+		{
+			frame.modifier = DRM_FORMAT_MOD_INVALID;
+			CHECK(driElements.importDmabuf(frame, fbId));
+		}
+		scanout(driElements, fbId);
+		driElements.releaseDmabuf(fbId);
+		close(dmabuf);
+	}
+	CHECK(device.prime.imported() == 0);
+	close(memfd);
+	close(dev);
+}
+
+int main(int argc, const char *argv[])
+{
+	try
+	{
+		AVAL_VIDEO_SIZE_T s; s.w = 1920; s.h = 1080;
+		DRIElements driElements(s, [](const DisplayChange &change) {});
+		if (driElements.mPrimaryDev == "")
+		{
+			std::cout << "no DRM device" << std::endl;
+			return 1;
+		}
+		DriDevice &device = driElements.mDeviceList[driElements.mPrimaryDev];
+		if (!device.prime.canImport() || !device.prime.canExport())
+		{
+			std::cout << device.deviceName << " (" << device.driverName << ") has no PRIME import and export" << std::endl;
+			return 1;
+		}
+		testExportImport(driElements, device);
+		testExportedNotRecycled(device);
+		testUdmabuf(driElements, device);
+	}
+	catch (FatalException e)
+	{
+		std::cout << "Fatal Exception" << e.what();
+		return 1;
+	}
+	return testResult();
+}
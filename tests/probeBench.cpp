@@ -0,0 +1,124 @@
+// Copyright (c) 2017-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <drm_fourcc.h>
+#include "driElements.h"
+#include "buffers.h"
+#include "bufferPool.h"
+#include "mappingCache.h"
+#include "logging.h"
+
+//Counts connector probes made per display API call. Before connection
+//snapshots every changeMode and mode range query ran a full
+//drmModeGetConnector probe (detect + EDID over DDC) per connector.
+
+static const int ITERATIONS = 100;
+
+template <typename F>
+static void bench(const char *name, F call)
+{
+	uint64_t probes = DrmConnector::sFullProbes;
+	uint64_t reads = DrmConnector::sCurrentReads;
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < ITERATIONS; i++)
+	{
+		call();
+	}
+	auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+	std::cout << name << ": "
+	          << double(DrmConnector::sFullProbes - probes) / ITERATIONS << " full probes/call, "
+	          << double(DrmConnector::sCurrentReads - reads) / ITERATIONS << " current reads/call, "
+	          << double(us) / ITERATIONS << " us/call" << std::endl;
+}
+
+int main (int argc, const char *argv[])
+{
+	try
+	{
+		AVAL_VIDEO_SIZE_T s; s.w=1920; s.h=1080;
+		auto start = std::chrono::steady_clock::now();
+		DRIElements driElements(s, [](const DisplayChange &change) {});
+		auto startupUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+		if (driElements.mPrimaryDev == "")
+		{
+			std::cout << "no DRM device" << std::endl;
+			return 1;
+		}
+		DriDevice &driDevice = driElements.mDeviceList[driElements.mPrimaryDev];
+		std::cout << "startup: " << driElements.mDeviceList.size() << " cards in " << startupUs << " us, "
+		          << DrmConnector::sFullProbes << " full probes, "
+		          << DrmConnector::sCurrentReads << " current reads" << std::endl;
+
+		std::vector<AVAL_VIDEO_SIZE_T> modes = driElements.getSupportedModes();
+		bench("getSupportedModes", [&]() { driElements.getSupportedModes(); });
+		bench("geModeRange", [&]()
+		{
+			AVAL_VIDEO_SIZE_T min, max;
+			driDevice.geModeRange(min, max);
+		});
+		bench("changeMode (current)", [&]() { driElements.changeMode(driDevice.width, driDevice.height); });
+		if (modes.size() > 1)
+		{
+			//Toggle between the first two sizes, each call is a real modeset
+			int i = 0;
+			bench("changeMode (toggle)", [&]()
+			{
+				const AVAL_VIDEO_SIZE_T &m = modes[i++ % 2];
+				driElements.changeMode(m.w, m.h);
+			});
+		}
+		bench("probeConnectors (current)", [&]() { driDevice.probeConnectors(std::set<uint32_t>(), false); });
+		bench("probeConnectors (hotplug)", [&]() { driDevice.probeConnectors(); });
+
+		//A frame allocated and freed per iteration, as a client allocating at runtime does
+		auto frame = [&]()
+		{
+			unsigned int handles[4] = {0}, pitches[4] = {0}, offsets[4] = {0};
+			bo_destroy(bo_create(driDevice.drmModuleFd, DRM_FORMAT_XRGB8888, 1920, 1080, handles, pitches, offsets));
+		};
+		size_t budget = DumbBufferPool::instance().budget();
+		DumbBufferPool::instance().setBudget(0);
+		bench("bo_create/bo_destroy (unpooled)", frame);
+		DumbBufferPool::instance().setBudget(budget);
+		bench("bo_create/bo_destroy (pooled)", frame);
+		std::cout << DumbBufferPool::instance().summary() << std::endl;
+
+		unsigned int handles[4] = {0}, pitches[4] = {0}, offsets[4] = {0};
+		struct bo *bo = bo_create(driDevice.drmModuleFd, DRM_FORMAT_XRGB8888, 1920, 1080, handles, pitches, offsets);
+		bench("bo_map/bo_unmap", [&]()
+		{
+			void *ptr;
+			if (!bo_map(bo, &ptr))
+			{
+				bo_unmap(bo);
+			}
+		});
+		bo_destroy(bo);
+		std::cout << BoMappingCache::instance().summary() << std::endl;
+	}
+	catch (FatalException e)
+	{
+		std::cout << "Fatal Exception" << e.what();
+		return 1;
+	}
+	return 0;
+}
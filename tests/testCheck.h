@@ -0,0 +1,41 @@
+// Copyright (c) 2017-2018 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+
+#pragma once
+
+#include <iostream>
+
+//Shared by the test programs: CHECK records a failed condition and goes on,
+//testResult prints the verdict and turns it into the exit code.
+
+static int failures = 0;
+
+#define CHECK(cond) \
+	do { \
+		if (!(cond)) \
+		{ \
+			std::cerr << __FILE__ << ":" << __LINE__ << ": " << #cond << std::endl; \
+			failures++; \
+		} \
+	} while (0)
+
+static inline int testResult()
+{
+	std::cout << (failures ? "FAILED" : "PASSED") << " (" << failures << " failures)" << std::endl;
+	return failures ? 1 : 0;
+}